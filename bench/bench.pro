@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# Benchmarks, see the .pro file of each one
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += widget \
+    resampler \
+    compositor
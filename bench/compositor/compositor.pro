@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# ImageGridCompositor benchmarks at 1, 2, 4 and 8 threads
+#
+# Use "-o results.xml,xml" or "-o results.csv,csv"
+# for machine-readable results.
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+TARGET = imagegridcompositorbench
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+
+SOURCES += imagegridcompositorbenchmark.cpp \
+    ../../imagegridcompositor.cpp \
+    ../../imagegridlayout.cpp \
+    ../../imagegridmodel.cpp \
+    ../../imagegriddiskcache.cpp \
+    ../../imagegridsource.cpp \
+    ../../imagegridresampler.cpp
+
+HEADERS  += ../../imagegridcompositor.hpp \
+    ../../imagegridlayout.hpp \
+    ../../imagegridmodel.hpp \
+    ../../imagegriddiskcache.hpp \
+    ../../imagegridsource.hpp \
+    ../../imagegridresampler.hpp
+
+QMAKE_CXXFLAGS += -std=c++11
@@ -0,0 +1,120 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QColor>
+#include <QImage>
+#include <QLinearGradient>
+#include <QObject>
+#include <QPainter>
+#include <QPen>
+#include <QSize>
+#include <QString>
+#include <QtTest>
+#include "../../imagegridcompositor.hpp"
+#include "../../imagegridlayout.hpp"
+#include "../../imagegridmodel.hpp"
+
+/**
+ * @brief Benchmarks for ImageGridCompositor
+ *
+ * Renders a collage of photo-sized images with 1, 2, 4 and 8 threads,
+ * so the speedup over a single thread can be read from the results.
+ */
+class ImageGridCompositorBenchmark : public QObject
+{
+    Q_OBJECT
+
+    //! Number of images in the collage
+    static const int Images = 120;
+
+    //! Images on each row
+    static const int ColumnsPerRow = 6;
+
+    //! Width of the collage
+    static const int CollageWidth = 6000;
+
+    //! Grid to render
+    ImageGridModel model_;
+
+private slots:
+    void initTestCase();
+
+    void compose_data();
+
+    void compose();
+};
+
+void ImageGridCompositorBenchmark::initTestCase()
+{
+    // Gradients with hard edges, so the resampler doesn't get a flat image
+    QImage image(3000, 2000, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, image.width(), image.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, QColor(0, 128, 255, 200));
+    gradient.setColorAt(1, Qt::yellow);
+    painter.fillRect(image.rect(), gradient);
+    painter.setPen(QPen(Qt::black, 3));
+    for(auto x = 0; x < image.width(); x += 37) {
+        painter.drawLine(x, 0, image.width() - x, image.height());
+    }
+
+    painter.end();
+
+    // Every tile has a source of its own, like images read from files
+    for(auto i = 0; i < Images; ++i) {
+        const auto row = i / ColumnsPerRow;
+        if(i % ColumnsPerRow == 0) {
+            model_.insertRow(row, image);
+        }
+        else {
+            model_.insert(row, i % ColumnsPerRow, image);
+        }
+    }
+}
+
+void ImageGridCompositorBenchmark::compose_data()
+{
+    QTest::addColumn<int>("threads");
+
+    for(const auto threads : {1, 2, 4, 8}) {
+        QTest::newRow(qPrintable(QString("%1 threads").arg(threads))) << threads;
+    }
+}
+
+void ImageGridCompositorBenchmark::compose()
+{
+    QFETCH(int, threads);
+
+    const ImageGridLayout layout(CollageWidth, 10, model_.sizeAt(0, 0));
+    ImageGridCompositor compositor(Qt::white);
+    compositor.setThreadCount(threads);
+    QBENCHMARK {
+        compositor.compose(model_, layout);
+    }
+}
+
+QTEST_MAIN(ImageGridCompositorBenchmark)
+
+#include "imagegridcompositorbenchmark.moc"
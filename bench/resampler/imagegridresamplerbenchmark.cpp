@@ -0,0 +1,195 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QColor>
+#include <QImage>
+#include <QLinearGradient>
+#include <QObject>
+#include <QPainter>
+#include <QPen>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QtTest>
+#include "../../imagegridresampler.hpp"
+
+Q_DECLARE_METATYPE(ImageGridResampler::InstructionSet)
+Q_DECLARE_METATYPE(ImageGridResampler::Filter)
+
+/**
+ * @brief Benchmarks for ImageGridResampler
+ *
+ * Downscales a photo-sized image to typical tile sizes with every
+ * instruction set the CPU supports, and with QImage::scaled() for
+ * comparison.
+ */
+class ImageGridResamplerBenchmark : public QObject
+{
+    Q_OBJECT
+
+    //! Image to downscale
+    QImage source_;
+
+    /**
+     * @brief Get the target sizes every benchmark runs with
+     * @return Sizes
+     */
+    static QVector<QSize> sizes();
+
+    /**
+     * @brief Get the name of a target size in data rows
+     * @param size Size
+     * @return Name
+     */
+    static QString sizeName(const QSize &size);
+
+    /**
+     * @brief Add the target size column with data rows
+     */
+    static void addSizes();
+
+private slots:
+    void initTestCase();
+
+    void cleanupTestCase();
+
+    void qtFast_data();
+
+    void qtFast();
+
+    void qtSmooth_data();
+
+    void qtSmooth();
+
+    void resampler_data();
+
+    void resampler();
+};
+
+QVector<QSize> ImageGridResamplerBenchmark::sizes()
+{
+    return {QSize(1024, 768), QSize(400, 300), QSize(150, 113)};
+}
+
+QString ImageGridResamplerBenchmark::sizeName(const QSize &size)
+{
+    return QString("%1x%2").arg(size.width()).arg(size.height());
+}
+
+void ImageGridResamplerBenchmark::addSizes()
+{
+    QTest::addColumn<QSize>("size");
+
+    for(const QSize &size : sizes()) {
+        QTest::newRow(qPrintable(sizeName(size))) << size;
+    }
+}
+
+void ImageGridResamplerBenchmark::initTestCase()
+{
+    // Gradients with hard edges, so neither filter gets a flat image
+    source_ = QImage(3000, 2000, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&source_);
+    QLinearGradient gradient(0, 0, source_.width(), source_.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, QColor(0, 128, 255, 200));
+    gradient.setColorAt(1, Qt::yellow);
+    painter.fillRect(source_.rect(), gradient);
+    painter.setPen(QPen(Qt::black, 3));
+    for(auto x = 0; x < source_.width(); x += 37) {
+        painter.drawLine(x, 0, source_.width() - x, source_.height());
+    }
+}
+
+void ImageGridResamplerBenchmark::cleanupTestCase()
+{
+    ImageGridResampler::setInstructionSet(ImageGridResampler::supportedInstructionSet());
+}
+
+void ImageGridResamplerBenchmark::qtFast_data()
+{
+    addSizes();
+}
+
+void ImageGridResamplerBenchmark::qtFast()
+{
+    QFETCH(QSize, size);
+
+    QBENCHMARK {
+        source_.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+}
+
+void ImageGridResamplerBenchmark::qtSmooth_data()
+{
+    addSizes();
+}
+
+void ImageGridResamplerBenchmark::qtSmooth()
+{
+    QFETCH(QSize, size);
+
+    QBENCHMARK {
+        source_.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+}
+
+void ImageGridResamplerBenchmark::resampler_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<ImageGridResampler::InstructionSet>("set");
+    QTest::addColumn<ImageGridResampler::Filter>("filter");
+
+    // Only supported instruction sets get rows, their names tell which ones
+    const char *setNames[] = {"scalar", "sse2", "avx2"};
+    const char *filterNames[] = {"box", "lanczos"};
+    const auto supported = ImageGridResampler::supportedInstructionSet();
+    for(const QSize &size : sizes()) {
+        for(auto set = 0; set <= supported; ++set) {
+            for(auto filter = 0; filter < 2; ++filter) {
+                const QString name = QString("%1 %2 %3").arg(sizeName(size))
+                        .arg(setNames[set]).arg(filterNames[filter]);
+                QTest::newRow(qPrintable(name))
+                        << size << static_cast<ImageGridResampler::InstructionSet>(set)
+                        << static_cast<ImageGridResampler::Filter>(filter);
+            }
+        }
+    }
+}
+
+void ImageGridResamplerBenchmark::resampler()
+{
+    QFETCH(QSize, size);
+    QFETCH(ImageGridResampler::InstructionSet, set);
+    QFETCH(ImageGridResampler::Filter, filter);
+
+    ImageGridResampler::setInstructionSet(set);
+    QBENCHMARK {
+        ImageGridResampler::scaled(source_, size, filter);
+    }
+}
+
+QTEST_MAIN(ImageGridResamplerBenchmark)
+
+#include "imagegridresamplerbenchmark.moc"
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# ImageGridResampler benchmarks against QImage::scaled
+#
+# Use "-o results.xml,xml" or "-o results.csv,csv"
+# for machine-readable results.
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+TARGET = imagegridresamplerbench
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+
+SOURCES += imagegridresamplerbenchmark.cpp \
+    ../../imagegridresampler.cpp
+
+HEADERS  += ../../imagegridresampler.hpp
+
+QMAKE_CXXFLAGS += -std=c++11
@@ -0,0 +1,437 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QIcon>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPainter>
+#include <QPixmap>
+#include <QPoint>
+#include <QScopedPointer>
+#include <QSize>
+#include <QString>
+#include <QUndoStack>
+#include <QVector>
+#include <QtTest>
+#include "../../imagegridwidget.hpp"
+
+/**
+ * @brief Benchmarks for ImageGridWidget
+ *
+ * Every benchmark runs on grids of 10, 100, 1000 and 10000 tiles
+ * in both render modes. Inserting and removing also run on grids of
+ * 100000 tiles to show how they scale.
+ */
+class ImageGridWidgetBenchmark : public QObject
+{
+    Q_OBJECT
+
+    //! Tiles on every row of a generated grid
+    static const int ColumnsPerRow = 5;
+
+    //! Structural changes timed per data row
+    static const int Operations = 100;
+
+    //! Layout width of a generated grid
+    static const int GridWidth = 1000;
+
+    //! Synthetic images, in several aspect ratios
+    QVector<QIcon> icons_;
+
+    /**
+     * @brief Add the tile count and render mode columns with data rows
+     * @param large If grids of 100000 tiles are added as well
+     */
+    void addData(bool large = false) const;
+
+    /**
+     * @brief Create a widget for the current data row
+     * @return Widget with the grid filled in
+     */
+    ImageGridWidget *createWidget() const;
+
+    /**
+     * @brief Append tiles to a widget
+     * @param widget Widget to fill
+     * @param tiles Number of tiles
+     */
+    void populate(ImageGridWidget &widget, int tiles) const;
+
+    /**
+     * @brief Wait until every tile has its scaled pixmap
+     * @param widget Widget to wait for
+     */
+    static void waitForScaling(ImageGridWidget &widget);
+
+    /**
+     * @brief Report an average duration as the benchmark result
+     * @param nsecs Total duration in nanoseconds
+     * @param count Number of timed operations
+     */
+    static void setResult(qint64 nsecs, int count);
+
+private slots:
+    void initTestCase();
+
+    void insertBeforeRow_data();
+
+    void insertBeforeRow();
+
+    void insertBeforeIndex_data();
+
+    void insertBeforeIndex();
+
+    void removeAt_data();
+
+    void removeAt();
+
+    void setWidth_data();
+
+    void setWidth();
+
+    void setSpacing_data();
+
+    void setSpacing();
+
+    void hitTest_data();
+
+    void hitTest();
+
+    void paintEvent_data();
+
+    void paintEvent();
+
+    void setGrid_data();
+
+    void setGrid();
+
+    void clear_data();
+
+    void clear();
+};
+
+void ImageGridWidgetBenchmark::addData(const bool large) const
+{
+    QTest::addColumn<int>("tiles");
+    QTest::addColumn<int>("mode");
+
+    QVector<int> counts{10, 100, 1000, 10000};
+    if(large) {
+        counts.append(100000);
+    }
+
+    for(const auto tiles : counts) {
+        QTest::newRow(qPrintable(QString("%1 labels").arg(tiles)))
+                << tiles << static_cast<int>(ImageGridWidget::LabelRendering);
+        QTest::newRow(qPrintable(QString("%1 painted").arg(tiles)))
+                << tiles << static_cast<int>(ImageGridWidget::PaintedRendering);
+    }
+}
+
+ImageGridWidget *ImageGridWidgetBenchmark::createWidget() const
+{
+    QFETCH(int, tiles);
+    QFETCH(int, mode);
+
+    auto widget = new ImageGridWidget(10);
+    widget->setRenderMode(static_cast<ImageGridWidget::RenderMode>(mode));
+    widget->setWidth(GridWidth);
+
+    // Filling the grid isn't timed, lay it out once at the end
+    widget->beginUpdate();
+    populate(*widget, tiles);
+    widget->endUpdate();
+    return widget;
+}
+
+void ImageGridWidgetBenchmark::populate(ImageGridWidget &widget, const int tiles) const
+{
+    const auto start = widget.grid_.tileCount();
+    for(auto i = start; i < start + tiles; ++i) {
+        const QIcon &icon = icons_.at(i % icons_.size());
+        const auto row = i / ColumnsPerRow;
+        const auto column = i % ColumnsPerRow;
+        if(column == 0) {
+            widget.insertBefore(row, icon);
+        }
+        else {
+            widget.insertBefore(ImageGridWidget::Index(row, column), icon);
+        }
+    }
+}
+
+void ImageGridWidgetBenchmark::waitForScaling(ImageGridWidget &widget)
+{
+    QTRY_VERIFY_WITH_TIMEOUT(widget.pending_.isEmpty(), 120000);
+}
+
+void ImageGridWidgetBenchmark::setResult(const qint64 nsecs, const int count)
+{
+    QTest::setBenchmarkResult(static_cast<qreal>(nsecs) / count,
+                              QTest::WalltimeNanoseconds);
+}
+
+void ImageGridWidgetBenchmark::initTestCase()
+{
+    const QVector<QSize> sizes{QSize(160, 120), QSize(120, 160),
+                               QSize(200, 100), QSize(128, 128)};
+    for(auto i = 0; i < sizes.size(); ++i) {
+        QImage image(sizes.at(i), QImage::Format_ARGB32_Premultiplied);
+        image.fill(QColor::fromHsv(i * 90, 200, 200));
+        QPainter painter(&image);
+        painter.drawLine(0, 0, image.width(), image.height());
+        icons_.append(QIcon(QPixmap::fromImage(image)));
+    }
+}
+
+void ImageGridWidgetBenchmark::insertBeforeRow_data()
+{
+    addData(true);
+}
+
+void ImageGridWidgetBenchmark::insertBeforeRow()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    const auto row = widget->grid_.rowCount() / 2;
+
+    // Only the insertion is timed, the removal keeps the grid size constant
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for(auto i = 0; i < Operations; ++i) {
+        timer.start();
+        widget->insertBefore(row, icons_.at(i % icons_.size()));
+        elapsed += timer.nsecsElapsed();
+        widget->removeAt(row);
+    }
+
+    setResult(elapsed, Operations);
+}
+
+void ImageGridWidgetBenchmark::insertBeforeIndex_data()
+{
+    addData(true);
+}
+
+void ImageGridWidgetBenchmark::insertBeforeIndex()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    const ImageGridWidget::Index index(widget->grid_.rowCount() / 2, 1);
+
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for(auto i = 0; i < Operations; ++i) {
+        timer.start();
+        widget->insertBefore(index, icons_.at(i % icons_.size()));
+        elapsed += timer.nsecsElapsed();
+        widget->removeAt(index);
+        widget->resizeWidgets();
+    }
+
+    setResult(elapsed, Operations);
+}
+
+void ImageGridWidgetBenchmark::removeAt_data()
+{
+    addData(true);
+}
+
+void ImageGridWidgetBenchmark::removeAt()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    const ImageGridWidget::Index index(widget->grid_.rowCount() / 2, 0);
+
+    // Removal is followed by resizeWidgets() like a click would be
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for(auto i = 0; i < Operations; ++i) {
+        const QIcon icon = widget->iconAt(index);
+        timer.start();
+        widget->removeAt(index);
+        widget->resizeWidgets();
+        elapsed += timer.nsecsElapsed();
+        // Put the tile back, as a new row if its row went away
+        if(widget->grid_.columnCount(index.first) == ColumnsPerRow - 1) {
+            widget->insertBefore(index, icon);
+        }
+        else {
+            widget->insertBefore(index.first, icon);
+        }
+    }
+
+    setResult(elapsed, Operations);
+}
+
+void ImageGridWidgetBenchmark::setWidth_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::setWidth()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+
+    // Property changes only schedule a relayout, run it right away
+    auto width = GridWidth;
+    QBENCHMARK {
+        width = width == GridWidth ? GridWidth + 1 : GridWidth;
+        widget->setWidth(width);
+        widget->resizeWidgets();
+    }
+}
+
+void ImageGridWidgetBenchmark::setSpacing_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::setSpacing()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+
+    auto spacing = 10;
+    QBENCHMARK {
+        spacing = spacing == 10 ? 11 : 10;
+        widget->setSpacing(spacing);
+        widget->resizeWidgets();
+    }
+}
+
+void ImageGridWidgetBenchmark::hitTest_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::hitTest()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    const auto &geometry = widget->geometry_;
+
+    // Cursor positions spread evenly over the grid
+    QVector<QPoint> points;
+    for(auto y = 0; y < 16; ++y) {
+        for(auto x = 0; x < 16; ++x) {
+            points.append(QPoint(x * geometry.width() / 16, y * geometry.height() / 16));
+        }
+    }
+
+    auto hits = 0;
+    QBENCHMARK {
+        for(const QPoint &point : points) {
+            widget->point_ = point;
+            const QPair<int, int> v = widget->getVertical();
+            hits += widget->getHorizontal(v.second).second;
+        }
+    }
+
+    QVERIFY(hits >= 0);
+}
+
+void ImageGridWidgetBenchmark::paintEvent_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::paintEvent()
+{
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    waitForScaling(*widget);
+    if(QTest::currentTestFailed()) {
+        return;
+    }
+
+    widget->resize(widget->sizeHint());
+
+    // Paint one screen, like a scroll area viewport would
+    const QRect viewport(0, 0, GridWidth, qMin(widget->height(), 1080));
+    QImage target(viewport.size(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        widget->render(&target, QPoint(), QRegion(viewport));
+    }
+}
+
+void ImageGridWidgetBenchmark::setGrid_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::setGrid()
+{
+    QFETCH(int, tiles);
+    QFETCH(int, mode);
+
+    QList<QList<QIcon>> rows;
+    for(auto i = 0; i < tiles; ++i) {
+        if(i % ColumnsPerRow == 0) {
+            rows.append(QList<QIcon>());
+        }
+
+        rows.last().append(icons_.at(i % icons_.size()));
+    }
+
+    ImageGridWidget widget(10);
+    widget.setRenderMode(static_cast<ImageGridWidget::RenderMode>(mode));
+    widget.setWidth(GridWidth);
+
+    // Don't let the history of earlier iterations pile up
+    widget.undoStack()->setUndoLimit(1);
+    QBENCHMARK {
+        widget.setGrid(rows);
+    }
+}
+
+void ImageGridWidgetBenchmark::clear_data()
+{
+    addData();
+}
+
+void ImageGridWidgetBenchmark::clear()
+{
+    QFETCH(int, tiles);
+
+    // Every iteration clears a full grid, refilling it isn't timed
+    const auto clears = 10;
+    QScopedPointer<ImageGridWidget> widget(createWidget());
+    widget->undoStack()->setUndoLimit(1);
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    for(auto i = 0; i < clears; ++i) {
+        timer.start();
+        widget->clear();
+        elapsed += timer.nsecsElapsed();
+        QCOMPARE(widget->grid_.tileCount(), 0);
+
+        widget->beginUpdate();
+        populate(*widget, tiles);
+        widget->endUpdate();
+    }
+
+    setResult(elapsed, clears);
+}
+
+QTEST_MAIN(ImageGridWidgetBenchmark)
+
+#include "imagegridwidgetbenchmark.moc"
@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# ImageGridWidget benchmarks
+#
+# Run headless with QT_QPA_PLATFORM=offscreen.
+# Use "-o results.xml,xml" or "-o results.csv,csv"
+# for machine-readable results.
+#
+#-------------------------------------------------
+
+QT       += core gui widgets testlib
+
+TARGET = imagegridwidgetbench
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+
+SOURCES += imagegridwidgetbenchmark.cpp \
+    ../../imagegridwidget.cpp \
+    ../../imagegridmodel.cpp \
+    ../../imagegridgeometry.cpp \
+    ../../imagegridscaler.cpp \
+    ../../imagegridpixmapcache.cpp \
+    ../../imagegridimagewriter.cpp \
+    ../../imagegridlayout.cpp \
+    ../../imagegridcompositor.cpp \
+    ../../imagegriddiskcache.cpp \
+    ../../imagegridsource.cpp \
+    ../../imagegridresampler.cpp \
+    ../../imagegridcommands.cpp \
+    ../../imagegridprojectfile.cpp \
+    ../../imagegridstats.cpp
+
+HEADERS  += ../../imagegridwidget.hpp \
+    ../../imagegridmodel.hpp \
+    ../../imagegridgeometry.hpp \
+    ../../imagegridscaler.hpp \
+    ../../imagegridpixmapcache.hpp \
+    ../../imagegridimagewriter.hpp \
+    ../../imagegridlayout.hpp \
+    ../../imagegridcompositor.hpp \
+    ../../imagegriddiskcache.hpp \
+    ../../imagegridsource.hpp \
+    ../../imagegridresampler.hpp \
+    ../../imagegridcommands.hpp \
+    ../../imagegridprojectfile.hpp \
+    ../../imagegridstats.hpp
+
+QMAKE_CXXFLAGS += -std=c++11
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Headless collage renderer, runs without a display
+# with QT_QPA_PLATFORM=offscreen
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = imagegridcli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+
+SOURCES += main.cpp \
+    ../imagegridcompositor.cpp \
+    ../imagegridgeometry.cpp \
+    ../imagegridlayout.cpp \
+    ../imagegridmodel.cpp \
+    ../imagegriddiskcache.cpp \
+    ../imagegridsource.cpp \
+    ../imagegridresampler.cpp
+
+HEADERS  += ../imagegridcompositor.hpp \
+    ../imagegridgeometry.hpp \
+    ../imagegridlayout.hpp \
+    ../imagegridmodel.hpp \
+    ../imagegriddiskcache.hpp \
+    ../imagegridsource.hpp \
+    ../imagegridresampler.hpp
+
+QMAKE_CXXFLAGS += -std=c++11
@@ -0,0 +1,236 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QColor>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include "../imagegridcompositor.hpp"
+#include "../imagegridlayout.hpp"
+#include "../imagegridmodel.hpp"
+#include "../imagegridsource.hpp"
+
+namespace {
+
+/**
+ * @brief Read a layout description into a model
+ *
+ * Every non-empty line is a row of image paths separated by '|'.
+ * Lines starting with '#' are comments.
+ * @param path Layout description file
+ * @param model Model to fill
+ * @param error Receives a description of the error
+ * @return True on success
+ */
+bool readLayout(const QString &path, ImageGridModel &model, QString &error) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QStringLiteral("%1: %2").arg(path, file.errorString());
+        return false;
+    }
+
+    QTextStream in(&file);
+    while(!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+
+        const auto row = model.rowCount();
+        // Empty parts are skipped here, the flag for it moved between Qt versions
+        const QStringList paths = line.split(QLatin1Char('|'));
+        for(const QString &rawPath : paths) {
+            const QString imagePath = rawPath.trimmed();
+            if(imagePath.isEmpty()) {
+                continue;
+            }
+
+            // Only the header is read, pixels are decoded at the size they're drawn at
+            const QSharedPointer<ImageGridSource> source = ImageGridSource::fromFile(imagePath);
+            if(!source) {
+                error = QStringLiteral("%1: Unreadable image").arg(imagePath);
+                return false;
+            }
+
+            if(model.rowCount() == row) {
+                model.insertRow(row, source);
+            }
+            else {
+                model.insert(row, model.columnCount(row), source);
+            }
+        }
+    }
+
+    if(model.isEmpty()) {
+        error = QStringLiteral("%1: No images").arg(path);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication a(argc, argv);
+    QGuiApplication::setApplicationName(QStringLiteral("imagegridcli"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Render an image grid collage"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("layout"),
+                                 QStringLiteral("Layout description, one row of "
+                                                "'|' separated image paths per line"));
+    parser.addPositionalArgument(QStringLiteral("output"),
+                                 QStringLiteral("Image file to write"));
+    const QCommandLineOption widthOption(QStringList() << "w" << "width",
+                                         QStringLiteral("Collage width in pixels, "
+                                                        "defaults to the first image width"),
+                                         QStringLiteral("pixels"), QStringLiteral("0"));
+    const QCommandLineOption spacingOption(QStringList() << "s" << "spacing",
+                                           QStringLiteral("Space between images in pixels"),
+                                           QStringLiteral("pixels"), QStringLiteral("0"));
+    const QCommandLineOption backgroundOption(QStringList() << "b" << "background",
+                                              QStringLiteral("Background color"),
+                                              QStringLiteral("color"),
+                                              QStringLiteral("transparent"));
+    const QCommandLineOption justifiedOption(QStringList() << "j" << "justified",
+                                             QStringLiteral("Keep the aspect ratio of every image"));
+    const QCommandLineOption rowHeightOption(QStringList() << "r" << "row-height",
+                                             QStringLiteral("Ignore the rows in the layout and "
+                                                            "arrange images into rows close "
+                                                            "to this height"),
+                                             QStringLiteral("pixels"), QStringLiteral("0"));
+    const QCommandLineOption threadsOption(QStringList() << "threads",
+                                           QStringLiteral("Number of threads drawing the "
+                                                          "collage, defaults to the number "
+                                                          "of cores"),
+                                           QStringLiteral("count"),
+                                           QString::number(qMax(1, QThread::idealThreadCount())));
+    const QCommandLineOption timingOption(QStringList() << "t" << "timing",
+                                          QStringLiteral("Print time spent in each phase"));
+    parser.addOption(widthOption);
+    parser.addOption(spacingOption);
+    parser.addOption(backgroundOption);
+    parser.addOption(justifiedOption);
+    parser.addOption(rowHeightOption);
+    parser.addOption(threadsOption);
+    parser.addOption(timingOption);
+    parser.process(a);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if(args.size() != 2) {
+        parser.showHelp(1);
+    }
+
+    bool widthOk = false;
+    bool spacingOk = false;
+    const auto width = parser.value(widthOption).toInt(&widthOk);
+    bool rowHeightOk = false;
+    const auto spacing = parser.value(spacingOption).toInt(&spacingOk);
+    const auto rowHeight = parser.value(rowHeightOption).toInt(&rowHeightOk);
+    bool threadsOk = false;
+    const auto threads = parser.value(threadsOption).toInt(&threadsOk);
+    const QColor background(parser.value(backgroundOption));
+    if(!widthOk || width < 0 || !spacingOk || spacing < 0
+            || !rowHeightOk || rowHeight < 0 || !threadsOk || threads < 1
+            || !background.isValid()) {
+        err << "Invalid width, spacing, row height, thread count or background color\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ImageGridModel model;
+    QString error;
+    if(!readLayout(args.at(0), model, error)) {
+        err << error << '\n';
+        return 1;
+    }
+
+    const auto loadTime = timer.nsecsElapsed();
+    timer.restart();
+
+    ImageGridLayout layout(width, spacing, model.sizeAt(0, 0));
+    if(parser.isSet(justifiedOption)) {
+        layout.setMode(ImageGridLayout::JustifiedRows);
+    }
+
+    if(rowHeight > 0) {
+        QVector<QSize> images;
+        images.reserve(model.tileCount());
+        for(auto row = 0; row < model.rowCount(); ++row) {
+            for(auto col = 0; col < model.columnCount(row); ++col) {
+                images.append(model.sizeAt(row, col));
+            }
+        }
+
+        model.rearrange(layout.partition(images, rowHeight));
+    }
+
+    const QSize size = layout.size(model);
+
+    const auto layoutTime = timer.nsecsElapsed();
+    timer.restart();
+
+    ImageGridCompositor compositor(background);
+    compositor.setThreadCount(threads);
+    const QImage image = compositor.compose(model, layout);
+
+    const auto composeTime = timer.nsecsElapsed();
+    timer.restart();
+
+    if(image.isNull() || !image.save(args.at(1))) {
+        err << args.at(1) << ": Failed to write image\n";
+        return 1;
+    }
+
+    const auto saveTime = timer.nsecsElapsed();
+
+    if(parser.isSet(timingOption)) {
+        QTextStream out(stdout);
+        out << "images: " << model.tileCount() << '\n'
+            << "size: " << size.width() << 'x' << size.height() << '\n'
+            << "threads: " << threads << '\n'
+            << "load ms: " << loadTime / 1e6 << '\n'
+            << "layout ms: " << layoutTime / 1e6 << '\n'
+            << "compose ms: " << composeTime / 1e6 << '\n'
+            << "save ms: " << saveTime / 1e6 << '\n';
+    }
+
+    return 0;
+}
@@ -14,10 +14,36 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-    ..\imagegridwidget.cpp
+    ..\imagegridwidget.cpp \
+    ..\imagegridmodel.cpp \
+    ..\imagegridgeometry.cpp \
+    ..\imagegridscaler.cpp \
+    ..\imagegridpixmapcache.cpp \
+    ..\imagegridimagewriter.cpp \
+    ..\imagegridlayout.cpp \
+    ..\imagegridcompositor.cpp \
+    ..\imagegriddiskcache.cpp \
+    ..\imagegridsource.cpp \
+    ..\imagegridresampler.cpp \
+    ..\imagegridcommands.cpp \
+    ..\imagegridprojectfile.cpp \
+    ..\imagegridstats.cpp
 
 HEADERS  += mainwindow.hpp \
-    ..\imagegridwidget.hpp
+    ..\imagegridwidget.hpp \
+    ..\imagegridmodel.hpp \
+    ..\imagegridgeometry.hpp \
+    ..\imagegridscaler.hpp \
+    ..\imagegridpixmapcache.hpp \
+    ..\imagegridimagewriter.hpp \
+    ..\imagegridlayout.hpp \
+    ..\imagegridcompositor.hpp \
+    ..\imagegriddiskcache.hpp \
+    ..\imagegridsource.hpp \
+    ..\imagegridresampler.hpp \
+    ..\imagegridcommands.hpp \
+    ..\imagegridprojectfile.hpp \
+    ..\imagegridstats.hpp
 
 FORMS    += mainwindow.ui
 
@@ -22,12 +22,18 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ******************************************************************************/
 
+#include <QAction>
 #include <QFileDialog>
 #include <QIcon>
 #include <QImage>
+#include <QKeySequence>
 #include <QList>
 #include <QListWidgetItem>
+#include <QPixmap>
+#include <QSharedPointer>
 #include <QSize>
+#include <QUndoStack>
+#include "../imagegriddiskcache.hpp"
 #include "mainwindow.hpp"
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -37,23 +43,71 @@ MainWindow::MainWindow(QWidget *parent) :
     ui.setupUi(this);
     ui.spinBox->setValue(0);
 
+    // Spin boxes show quick previews while they change
+    ui.widget->setProgressive(true);
+
+    // Thumbnails decoded on earlier runs are read back from disk
+    QSharedPointer<ImageGridDiskCache> cache(new ImageGridDiskCache);
+    ui.widget->setDiskCache(cache);
+
+    auto undo = ui.widget->undoStack()->createUndoAction(this);
+    undo->setShortcut(QKeySequence::Undo);
+    addAction(undo);
+
+    auto redo = ui.widget->undoStack()->createRedoAction(this);
+    redo->setShortcut(QKeySequence::Redo);
+    addAction(redo);
+
+    auto save = new QAction(tr("Save project"), this);
+    save->setShortcut(QKeySequence::Save);
+    connect(save, &QAction::triggered, [this] {
+        const auto path = QFileDialog::getSaveFileName(this, tr("Save project"), QString(),
+                                                       tr("Image grid projects (*.igp)"));
+        if(!path.isEmpty()) {
+            ui.widget->saveProject(path);
+        }
+    });
+    addAction(save);
+
+    auto open = new QAction(tr("Open project"), this);
+    open->setShortcut(QKeySequence::Open);
+    connect(open, &QAction::triggered, [this] {
+        const auto path = QFileDialog::getOpenFileName(this, tr("Open project"), QString(),
+                                                       tr("Image grid projects (*.igp)"));
+        if(!path.isEmpty()) {
+            ui.widget->loadProject(path);
+        }
+    });
+    addAction(open);
+
     const auto list = QFileDialog::getOpenFileNames();
     if(list.isEmpty()) {
         return;
     }
 
+    // Thumbnails come from the cache, the grid reads the files itself
+    QSize iconSize;
     for(const auto &item : list) {
+        const QImage cached = cache->read(item, 150);
+        if(cached.isNull()) {
+            continue;
+        }
+
+        const QImage thumbnail = cached.width() > 150 ?
+                    cached.scaledToWidth(150, Qt::SmoothTransformation) : cached;
+
+        if(iconSize.isEmpty()) {
+            iconSize = thumbnail.size();
+        }
+
         auto w = new QListWidgetItem;
-        QIcon icon;
-        icon.addFile(item);
-        w->setIcon(icon);
+        w->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+        w->setData(Qt::UserRole, item);
         ui.listWidget->insertItem(0, w);
     }
 
     ui.listWidget->setResizeMode(QListView::Adjust);
-    QImage image;
-    image.load(list.first());
-    ui.listWidget->setIconSize(image.scaledToWidth(150).size());
+    ui.listWidget->setIconSize(iconSize);
     ui.listWidget->setFixedWidth(180);
     ui.listWidget->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 }
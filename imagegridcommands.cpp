@@ -0,0 +1,263 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QCoreApplication>
+#include <QPair>
+#include "imagegridcommands.hpp"
+#include "imagegridwidget.hpp"
+
+ImageGridInsertCommand::ImageGridInsertCommand(ImageGridWidget *widget, const int row,
+                                               const int column, const bool newRow,
+                                               const QIcon &icon,
+                                               const QSharedPointer<ImageGridSource> &source,
+                                               QUndoCommand *parent) :
+    QUndoCommand(QCoreApplication::translate("ImageGridWidget", "Insert image"), parent),
+    widget_(widget),
+    row_(row),
+    column_(newRow ? 0 : column),
+    newRow_(newRow),
+    position_(-1),
+    id_(0),
+    icon_(icon),
+    source_(source)
+{
+
+}
+
+void ImageGridInsertCommand::redo()
+{
+    // Earlier commands in a batch may have changed the grid since construction
+    if(position_ < 0) {
+        position_ = widget_->positionOf(qMakePair(row_, column_));
+    }
+
+    // Redoing brings back the same id so later commands still find the tile
+    id_ = widget_->insertTile(row_, column_, newRow_, position_, icon_, source_, id_);
+}
+
+void ImageGridInsertCommand::undo()
+{
+    widget_->removeTile(id_, qMakePair(row_, column_));
+}
+
+ImageGridRemoveCommand::ImageGridRemoveCommand(ImageGridWidget *widget, const int row,
+                                               const int column, QUndoCommand *parent) :
+    QUndoCommand(QCoreApplication::translate("ImageGridWidget", "Remove image"), parent),
+    widget_(widget),
+    row_(row),
+    column_(column),
+    wasRow_(false),
+    position_(0),
+    id_(0),
+    icon_(),
+    source_()
+{
+
+}
+
+void ImageGridRemoveCommand::redo()
+{
+    // Read the tile only now, earlier commands in a batch may have moved it
+    const ImageGridModel &grid = widget_->grid_;
+    if(id_ == 0) {
+        id_ = grid.idAt(row_, column_);
+    }
+    else {
+        const QPair<int, int> index = widget_->indexOf(id_, qMakePair(row_, column_));
+        row_ = index.first;
+        column_ = index.second;
+    }
+
+    wasRow_ = grid.columnCount(row_) == 1;
+    position_ = widget_->positionOf(qMakePair(row_, column_));
+    icon_ = grid.iconAt(row_, column_);
+    source_ = grid.sourceAt(row_, column_);
+
+    widget_->removeTile(id_, qMakePair(row_, column_));
+}
+
+void ImageGridRemoveCommand::undo()
+{
+    // The tile comes back with its old id, earlier commands still refer to it
+    widget_->insertTile(row_, column_, wasRow_, position_, icon_, source_, id_);
+}
+
+ImageGridRemoveTilesCommand::ImageGridRemoveTilesCommand(ImageGridWidget *widget,
+                                                         const QList<QPair<int, int>> &indexes,
+                                                         const QString &text,
+                                                         QUndoCommand *parent) :
+    QUndoCommand(text, parent),
+    widget_(widget),
+    indexes_(indexes),
+    ids_(),
+    tiles_()
+{
+
+}
+
+void ImageGridRemoveTilesCommand::redo()
+{
+    // Read the tiles only now, earlier commands in a batch may have moved them
+    const ImageGridModel &grid = widget_->grid_;
+    if(!indexes_.isEmpty()) {
+        for(const QPair<int, int> &index : indexes_) {
+            ids_.insert(grid.idAt(index.first, index.second));
+        }
+
+        ids_.remove(0);
+        indexes_.clear();
+    }
+
+    tiles_.clear();
+    tiles_.reserve(ids_.size());
+    auto position = 0;
+    const auto rows = grid.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid.columnCount(row);
+        auto wholeRow = true;
+        for(auto col = 0; col < cols && wholeRow; ++col) {
+            wholeRow = ids_.contains(grid.idAt(row, col));
+        }
+
+        for(auto col = 0; col < cols; ++col) {
+            if(ids_.contains(grid.idAt(row, col))) {
+                tiles_.append(Tile{row, col, wholeRow && col == 0, position + col,
+                                   grid.idAt(row, col), grid.iconAt(row, col),
+                                   grid.sourceAt(row, col)});
+            }
+        }
+
+        position += cols;
+    }
+
+    widget_->removeIds(ids_);
+}
+
+void ImageGridRemoveTilesCommand::undo()
+{
+    // Every tile before the next one is back in place, so its index is too.
+    // Tiles keep their ids, so ids_ still names them for the next redo()
+    widget_->beginUpdate();
+    for(const Tile &tile : tiles_) {
+        widget_->insertTile(tile.row, tile.column, tile.newRow, tile.position,
+                            tile.icon, tile.source, tile.id);
+    }
+
+    widget_->endUpdate();
+}
+
+ImageGridMoveCommand::ImageGridMoveCommand(ImageGridWidget *widget, const int row,
+                                           const int column, const int toRow,
+                                           const int toColumn, const bool newRow,
+                                           QUndoCommand *parent) :
+    QUndoCommand(QCoreApplication::translate("ImageGridWidget", "Move image"), parent),
+    widget_(widget),
+    row_(row),
+    column_(column),
+    toRow_(toRow),
+    toColumn_(newRow ? 0 : toColumn),
+    newRow_(newRow),
+    wasRow_(false),
+    position_(0),
+    id_(0)
+{
+
+}
+
+void ImageGridMoveCommand::redo()
+{
+    if(id_ == 0) {
+        id_ = widget_->grid_.idAt(row_, column_);
+    }
+
+    const QPair<int, int> from = widget_->indexOf(id_, qMakePair(row_, column_));
+    wasRow_ = widget_->grid_.columnCount(from.first) == 1;
+    position_ = widget_->positionOf(from);
+    row_ = from.first;
+    column_ = from.second;
+
+    widget_->moveTile(from, qMakePair(toRow_, toColumn_), newRow_);
+}
+
+void ImageGridMoveCommand::undo()
+{
+    // Taking the tile out again leaves the same grid it was moved out of
+    const QPair<int, int> from = widget_->indexOf(id_, qMakePair(toRow_, toColumn_));
+    if(widget_->targetRowHeight() == 0) {
+        widget_->moveTile(from, qMakePair(row_, column_), wasRow_);
+        return;
+    }
+
+    // Arranged rows were split again after the move, only the order of
+    // the other tiles is the same, so the tile goes back by position
+    const ImageGridModel &grid = widget_->grid_;
+    const QIcon icon = grid.iconAt(from.first, from.second);
+    const QSharedPointer<ImageGridSource> source = grid.sourceAt(from.first, from.second);
+    widget_->beginUpdate();
+    widget_->removeTile(id_, from);
+    widget_->insertTile(row_, column_, wasRow_, position_, icon, source, id_);
+    widget_->endUpdate();
+}
+
+ImageGridMoveRowCommand::ImageGridMoveRowCommand(ImageGridWidget *widget, const int row,
+                                                 const int toRow, QUndoCommand *parent) :
+    QUndoCommand(QCoreApplication::translate("ImageGridWidget", "Move row"), parent),
+    widget_(widget),
+    row_(row),
+    toRow_(toRow)
+{
+
+}
+
+void ImageGridMoveRowCommand::redo()
+{
+    widget_->moveRow(row_, toRow_);
+}
+
+void ImageGridMoveRowCommand::undo()
+{
+    widget_->moveRow(toRow_, row_);
+}
+
+ImageGridBatchCommand::ImageGridBatchCommand(ImageGridWidget *widget, const QString &text,
+                                             QUndoCommand *parent) :
+    QUndoCommand(text, parent),
+    widget_(widget)
+{
+
+}
+
+void ImageGridBatchCommand::redo()
+{
+    widget_->beginUpdate();
+    QUndoCommand::redo();
+    widget_->endUpdate();
+}
+
+void ImageGridBatchCommand::undo()
+{
+    widget_->beginUpdate();
+    QUndoCommand::undo();
+    widget_->endUpdate();
+}
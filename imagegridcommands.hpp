@@ -0,0 +1,316 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDCOMMANDS_HPP
+#define IMAGEGRIDCOMMANDS_HPP
+
+#include <QIcon>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QUndoCommand>
+#include <QVector>
+#include "imagegridsource.hpp"
+
+class ImageGridWidget;
+
+/**
+ * @brief Undoable insertion of a single tile
+ *
+ * Only the position and the shared image source are stored so the
+ * history costs a few bytes per edit and redoing never decodes the
+ * image again.
+ */
+class ImageGridInsertCommand : public QUndoCommand
+{
+    //! Grid to insert into
+    ImageGridWidget *widget_;
+
+    //! Row to insert into or before
+    int row_;
+
+    //! Column to insert before
+    int column_;
+
+    //! If the tile is inserted as a new row
+    bool newRow_;
+
+    //! Number of tiles before the inserted one, -1 until the first redo()
+    int position_;
+
+    //! Id of the inserted tile, 0 until the first redo()
+    quint64 id_;
+
+    //! Icon the source was made from, may be null
+    QIcon icon_;
+
+    //! Image of the tile
+    QSharedPointer<ImageGridSource> source_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param widget Grid to insert into
+     * @param row Row to insert into, or before if newRow is true
+     * @param column Column to insert before, ignored if newRow is true
+     * @param newRow If the tile is inserted as a new row
+     * @param icon Icon the source was made from, may be null
+     * @param source Image of the tile
+     * @param parent Batch the command belongs to
+     */
+    ImageGridInsertCommand(ImageGridWidget *widget, int row, int column, bool newRow,
+                           const QIcon &icon, const QSharedPointer<ImageGridSource> &source,
+                           QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+/**
+ * @brief Undoable removal of a single tile
+ *
+ * The removed tile's image source is kept so undoing puts the same
+ * image back and finds its scaled pixmaps in the pixmap cache.
+ */
+class ImageGridRemoveCommand : public QUndoCommand
+{
+    //! Grid to remove from
+    ImageGridWidget *widget_;
+
+    //! Row of the tile
+    int row_;
+
+    //! Column of the tile
+    int column_;
+
+    //! If the tile was the last one on its row
+    bool wasRow_;
+
+    //! Number of tiles before the removed one
+    int position_;
+
+    //! Id of the tile, 0 until the first redo()
+    quint64 id_;
+
+    //! Icon of the removed tile
+    QIcon icon_;
+
+    //! Image of the removed tile
+    QSharedPointer<ImageGridSource> source_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param widget Grid to remove from
+     * @param row Row of the tile
+     * @param column Column of the tile
+     * @param parent Batch the command belongs to
+     */
+    ImageGridRemoveCommand(ImageGridWidget *widget, int row, int column,
+                           QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+/**
+ * @brief Undoable removal of many tiles at once
+ *
+ * The tiles are found and taken out of the grid in a single pass and
+ * the grid is laid out once, however many tiles are removed. Undoing
+ * puts the tiles back in reading order so each one lands where it was.
+ */
+class ImageGridRemoveTilesCommand : public QUndoCommand
+{
+    //! A removed tile
+    struct Tile {
+        //! Row of the tile
+        int row;
+
+        //! Column of the tile
+        int column;
+
+        //! If the tile starts a row that was removed with it
+        bool newRow;
+
+        //! Number of tiles before the removed one
+        int position;
+
+        //! Id of the removed tile, given back on undo()
+        quint64 id;
+
+        //! Icon of the removed tile
+        QIcon icon;
+
+        //! Image of the removed tile
+        QSharedPointer<ImageGridSource> source;
+    };
+
+    //! Grid to remove from
+    ImageGridWidget *widget_;
+
+    //! Tiles to remove, only read on the first redo()
+    QList<QPair<int, int>> indexes_;
+
+    //! Ids of the tiles to remove
+    QSet<quint64> ids_;
+
+    //! Removed tiles in reading order
+    QVector<Tile> tiles_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param widget Grid to remove from
+     * @param indexes Tiles to remove
+     * @param text Text shown in the undo history
+     * @param parent Batch the command belongs to
+     */
+    ImageGridRemoveTilesCommand(ImageGridWidget *widget, const QList<QPair<int, int>> &indexes,
+                                const QString &text, QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+/**
+ * @brief Undoable move of a single tile
+ *
+ * The tile keeps its id and pixmap, only the rows it leaves and
+ * enters are laid out again. With a target row height the rows are
+ * split again after the move, so undo puts the tile back by position.
+ */
+class ImageGridMoveCommand : public QUndoCommand
+{
+    //! Grid to move in
+    ImageGridWidget *widget_;
+
+    //! Row the tile is moved from
+    int row_;
+
+    //! Column the tile is moved from
+    int column_;
+
+    //! Row to move into, or before if newRow_ is true
+    int toRow_;
+
+    //! Column to move before, without the moved tile
+    int toColumn_;
+
+    //! If the tile becomes a row of its own
+    bool newRow_;
+
+    //! If the tile was the last one on its row
+    bool wasRow_;
+
+    //! Number of tiles before the tile before it was moved
+    int position_;
+
+    //! Id of the tile, 0 until the first redo()
+    quint64 id_;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * The destination is given as if the tile had already been removed
+     * @param widget Grid to move in
+     * @param row Row of the tile
+     * @param column Column of the tile
+     * @param toRow Row to move into, or before if newRow is true
+     * @param toColumn Column to move before, ignored if newRow is true
+     * @param newRow If the tile becomes a row of its own
+     * @param parent Batch the command belongs to
+     */
+    ImageGridMoveCommand(ImageGridWidget *widget, int row, int column,
+                         int toRow, int toColumn, bool newRow,
+                         QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+/**
+ * @brief Undoable move of a whole row
+ */
+class ImageGridMoveRowCommand : public QUndoCommand
+{
+    //! Grid to move in
+    ImageGridWidget *widget_;
+
+    //! Row to move
+    int row_;
+
+    //! Row to move before, without the moved row
+    int toRow_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param widget Grid to move in
+     * @param row Row to move
+     * @param toRow Row to move before, as if the row had already been removed
+     * @param parent Batch the command belongs to
+     */
+    ImageGridMoveRowCommand(ImageGridWidget *widget, int row, int toRow,
+                            QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+/**
+ * @brief Group of commands undone and redone as one step
+ *
+ * The child commands run inside a single beginUpdate() and endUpdate()
+ * pair so the grid is laid out once per undo or redo.
+ */
+class ImageGridBatchCommand : public QUndoCommand
+{
+    //! Grid the child commands change
+    ImageGridWidget *widget_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param widget Grid the child commands change
+     * @param text Text shown in undo views
+     * @param parent Batch the command belongs to
+     */
+    ImageGridBatchCommand(ImageGridWidget *widget, const QString &text,
+                          QUndoCommand *parent = 0);
+
+    void redo() override;
+
+    void undo() override;
+};
+
+#endif // IMAGEGRIDCOMMANDS_HPP
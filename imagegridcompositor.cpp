@@ -0,0 +1,250 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include "imagegridcompositor.hpp"
+#include "imagegridlayout.hpp"
+#include "imagegridmodel.hpp"
+
+namespace {
+
+//! Parts per thread, so threads that finish early pick up the rest
+const int PartsPerThread = 4;
+
+} // namespace
+
+class ImageGridCompositor::PartJob : public QRunnable
+{
+    const ImageGridCompositor *compositor_;
+    const ImageGridModel *model_;
+    uchar *bits_;
+    int bytesPerLine_;
+    Part part_;
+
+public:
+    PartJob(const ImageGridCompositor *compositor, const ImageGridModel *model,
+            uchar *bits, const int bytesPerLine, const Part &part) :
+        QRunnable(),
+        compositor_(compositor),
+        model_(model),
+        bits_(bits),
+        bytesPerLine_(bytesPerLine),
+        part_(part)
+    {
+
+    }
+
+    void run() override {
+        compositor_->paintPart(bits_, bytesPerLine_, *model_, part_);
+    }
+};
+
+ImageGridCompositor::ImageGridCompositor(const QColor &backgroundColor) :
+    backgroundColor_(backgroundColor),
+    mode_(Qt::SmoothTransformation),
+    filter_(ImageGridResampler::BoxFilter),
+    threadCount_(qMax(1, QThread::idealThreadCount())),
+    pool_()
+{
+    pool_.setMaxThreadCount(threadCount_);
+}
+
+QColor ImageGridCompositor::backgroundColor() const
+{
+    return backgroundColor_;
+}
+
+void ImageGridCompositor::setBackgroundColor(const QColor &color)
+{
+    backgroundColor_ = color;
+}
+
+Qt::TransformationMode ImageGridCompositor::transformationMode() const
+{
+    return mode_;
+}
+
+void ImageGridCompositor::setTransformationMode(const Qt::TransformationMode mode)
+{
+    mode_ = mode;
+}
+
+ImageGridResampler::Filter ImageGridCompositor::filter() const
+{
+    return filter_;
+}
+
+void ImageGridCompositor::setFilter(const ImageGridResampler::Filter filter)
+{
+    filter_ = filter;
+}
+
+int ImageGridCompositor::threadCount() const
+{
+    return threadCount_;
+}
+
+void ImageGridCompositor::setThreadCount(const int count)
+{
+    if(count < 1) {
+        qWarning("ImageGridCompositor::setThreadCount: Invalid count: %d", count);
+        return;
+    }
+
+    threadCount_ = count;
+    pool_.setMaxThreadCount(count);
+}
+
+QVector<ImageGridCompositor::Part> ImageGridCompositor::split(const ImageGridModel &model,
+                                                              const ImageGridLayout &layout,
+                                                              const int row,
+                                                              const int count) const
+{
+    const auto width = layout.layoutWidth();
+    const auto spacing = layout.spacing();
+    const auto wanted = threadCount_ == 1 ? 1 : threadCount_ * PartsPerThread;
+    const auto partsPerRow = qMax(1, (wanted + count - 1) / count);
+
+    QVector<Part> parts;
+    auto y = 0;
+    for(auto r = row; r < row + count; ++r) {
+        const QVector<QSize> sizes = layout.rowSizes(model, r);
+        const auto lastRow = r + 1 == model.rowCount();
+        const auto height = layout.rowHeight(model, r) + (lastRow ? 0 : spacing);
+        const auto cols = sizes.size();
+        const auto perPart = qMax(1, (cols + partsPerRow - 1) / partsPerRow);
+        auto x = 0;
+        for(auto col = 0; col < cols; col += perPart) {
+            const auto n = qMin(perPart, cols - col);
+            auto right = x;
+            for(auto idx = col; idx < col + n; ++idx) {
+                right += sizes.at(idx).width() + spacing;
+            }
+
+            // The last part also covers whatever the row leaves empty
+            right = col + n == cols ? width : qMin(right, width);
+            if(right > x) {
+                parts.append(Part{r, col, n, QRect(x, y, right - x, height), sizes, spacing});
+            }
+
+            x = right;
+        }
+
+        y += height;
+    }
+
+    return parts;
+}
+
+void ImageGridCompositor::paintPart(uchar *bits, const int bytesPerLine,
+                                    const ImageGridModel &model, const Part &part) const
+{
+    // Each part gets its own image on the shared pixels, painters can't share one
+    const QRect &rect = part.rect;
+    QImage image(bits + rect.top() * bytesPerLine + rect.left() * 4,
+                 rect.width(), rect.height(), bytesPerLine,
+                 QImage::Format_ARGB32_Premultiplied);
+    image.fill(backgroundColor_);
+
+    QPainter painter(&image);
+    auto x = 0;
+    for(auto col = part.column; col < part.column + part.count; ++col) {
+        const QSize &size = part.sizes.at(col);
+        // Images decoded only for this render are not kept in the model
+        const QImage source = model.imageAt(part.row, col, size, false);
+        if(!source.isNull()) {
+            painter.drawImage(x, 0, mode_ == Qt::SmoothTransformation ?
+                                  ImageGridResampler::scaled(source, size, filter_) :
+                                  source.scaled(size, Qt::IgnoreAspectRatio, mode_));
+        }
+
+        x += size.width() + part.spacing;
+    }
+}
+
+QImage ImageGridCompositor::composeRow(const ImageGridModel &model,
+                                       const ImageGridLayout &layout,
+                                       const int row) const
+{
+    if(row < 0 || row >= model.rowCount()) {
+        qWarning("ImageGridCompositor::composeRow: Invalid row: %d", row);
+        return {};
+    }
+
+    return composeRows(model, layout, row, 1);
+}
+
+QImage ImageGridCompositor::composeRows(const ImageGridModel &model,
+                                        const ImageGridLayout &layout,
+                                        const int row, const int count) const
+{
+    if(row < 0 || count <= 0 || row + count > model.rowCount()) {
+        qWarning("ImageGridCompositor::composeRows: Invalid rows: %d+%d", row, count);
+        return {};
+    }
+
+    const QVector<Part> parts = split(model, layout, row, count);
+    if(parts.isEmpty()) {
+        qWarning("ImageGridCompositor::composeRows: Empty rows");
+        return {};
+    }
+
+    QImage band(layout.layoutWidth(), parts.last().rect.bottom() + 1,
+                QImage::Format_ARGB32_Premultiplied);
+    if(band.isNull()) {
+        qWarning("ImageGridCompositor::composeRows: Out of memory");
+        return {};
+    }
+
+    // Detach once here, workers only get the raw scanlines
+    uchar *bits = band.bits();
+    const auto bytesPerLine = band.bytesPerLine();
+    if(threadCount_ == 1 || parts.size() == 1) {
+        for(const Part &part : parts) {
+            paintPart(bits, bytesPerLine, model, part);
+        }
+
+        return band;
+    }
+
+    for(const Part &part : parts) {
+        pool_.start(new PartJob(this, &model, bits, bytesPerLine, part));
+    }
+
+    pool_.waitForDone();
+    return band;
+}
+
+QImage ImageGridCompositor::compose(const ImageGridModel &model,
+                                    const ImageGridLayout &layout) const
+{
+    if(layout.size(model).isEmpty()) {
+        qWarning("ImageGridCompositor::compose: Empty grid");
+        return {};
+    }
+
+    return composeRows(model, layout, 0, model.rowCount());
+}
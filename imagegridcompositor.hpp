@@ -0,0 +1,219 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDCOMPOSITOR_HPP
+#define IMAGEGRIDCOMPOSITOR_HPP
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+#include "imagegridresampler.hpp"
+
+class QPainter;
+class ImageGridLayout;
+class ImageGridModel;
+
+/**
+ * @brief Renders an image grid into a QImage without any widgets
+ *
+ * Images are scaled from the source images kept by the model into the
+ * areas calculated by ImageGridLayout. Spacing is filled with the
+ * background color.
+ *
+ * The output is split into parts of whole rows or runs of tiles on a
+ * row, which worker threads decode, resample and draw straight into
+ * the shared image. The model must not change while rendering.
+ */
+class ImageGridCompositor
+{
+    //! Draws a part on a worker thread
+    class PartJob;
+
+    //! An area of the output drawn on its own
+    struct Part {
+        //! Row the tiles are on
+        int row;
+
+        //! First column drawn
+        int column;
+
+        //! Number of columns drawn
+        int count;
+
+        //! Area in the output, including the spacing right of and below the tiles
+        QRect rect;
+
+        //! Size of every image on the row
+        QVector<QSize> sizes;
+
+        //! Space between images
+        int spacing;
+    };
+
+    //! Color of the spacing between images
+    QColor backgroundColor_;
+
+    //! Transformation mode used for scaling
+    Qt::TransformationMode mode_;
+
+    //! Filter used with Qt::SmoothTransformation
+    ImageGridResampler::Filter filter_;
+
+    //! Number of threads drawing parts at once
+    int threadCount_;
+
+    //! Threads drawing the parts
+    mutable QThreadPool pool_;
+
+    /**
+     * @brief Split rows into parts that can be drawn independently
+     *
+     * Rows are split into runs of tiles when there are too few of them
+     * to keep every thread busy
+     * @param model Grid to render
+     * @param layout Layout of the grid
+     * @param row First row
+     * @param count Number of rows
+     * @return Parts covering the rows top to bottom
+     */
+    QVector<Part> split(const ImageGridModel &model, const ImageGridLayout &layout,
+                        int row, int count) const;
+
+    /**
+     * @brief Fill a part with the background and draw its images
+     *
+     * Touches only the pixels of the part, so parts can be drawn
+     * into the same image at the same time
+     * @param bits First scanline of the image
+     * @param bytesPerLine Bytes per scanline of the image
+     * @param model Grid to draw
+     * @param part Part to draw
+     */
+    void paintPart(uchar *bits, int bytesPerLine, const ImageGridModel &model,
+                   const Part &part) const;
+
+public:
+    /**
+     * @brief Constructor
+     * @param backgroundColor Color of the spacing between images
+     */
+    explicit ImageGridCompositor(const QColor &backgroundColor = Qt::transparent);
+
+    /**
+     * @brief Get color of the spacing between images
+     * @return Background color
+     */
+    QColor backgroundColor() const;
+
+    /**
+     * @brief Set color of the spacing between images
+     * @param color Background color
+     */
+    void setBackgroundColor(const QColor &color);
+
+    /**
+     * @brief Get transformation mode used for scaling
+     * @return Transformation mode
+     */
+    Qt::TransformationMode transformationMode() const;
+
+    /**
+     * @brief Set transformation mode used for scaling
+     *
+     * Qt::SmoothTransformation uses ImageGridResampler with filter(),
+     * Qt::FastTransformation uses QImage::scaled().
+     * Defaults to Qt::SmoothTransformation
+     * @param mode Transformation mode
+     */
+    void setTransformationMode(Qt::TransformationMode mode);
+
+    /**
+     * @brief Get filter used with Qt::SmoothTransformation
+     * @return Resampling filter
+     */
+    ImageGridResampler::Filter filter() const;
+
+    /**
+     * @brief Set filter used with Qt::SmoothTransformation
+     *
+     * Defaults to ImageGridResampler::BoxFilter
+     * @param filter Resampling filter
+     */
+    void setFilter(ImageGridResampler::Filter filter);
+
+    /**
+     * @brief Get number of threads drawing at once
+     * @return Thread count
+     */
+    int threadCount() const;
+
+    /**
+     * @brief Set number of threads drawing at once
+     *
+     * A count of 1 draws on the calling thread.
+     * Defaults to QThread::idealThreadCount()
+     * @param count Thread count
+     */
+    void setThreadCount(int count);
+
+    /**
+     * @brief Render a single row
+     *
+     * Every row except the last includes the spacing below it so that
+     * the bands of all rows stacked together make up the whole grid
+     * @param model Grid to render
+     * @param layout Layout of the grid
+     * @param row Row to render
+     * @return Row band as wide as the layout
+     */
+    QImage composeRow(const ImageGridModel &model, const ImageGridLayout &layout,
+                      int row) const;
+
+    /**
+     * @brief Render consecutive rows
+     *
+     * Every row except the last one of the grid includes the spacing
+     * below it, like composeRow()
+     * @param model Grid to render
+     * @param layout Layout of the grid
+     * @param row First row to render
+     * @param count Number of rows to render
+     * @return Band of rows as wide as the layout
+     */
+    QImage composeRows(const ImageGridModel &model, const ImageGridLayout &layout,
+                       int row, int count) const;
+
+    /**
+     * @brief Render the whole grid
+     * @param model Grid to render
+     * @param layout Layout of the grid
+     * @return Image of ImageGridLayout::size()
+     */
+    QImage compose(const ImageGridModel &model, const ImageGridLayout &layout) const;
+};
+
+#endif // IMAGEGRIDCOMPOSITOR_HPP
@@ -0,0 +1,269 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileInfoList>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSize>
+#include <QStandardPaths>
+#include <QStringList>
+#include "imagegriddiskcache.hpp"
+
+namespace {
+
+//! Smallest bucket in pixels
+const int MinBucket = 64;
+
+//! PNG quality, trades file size for faster writes
+const int PngQuality = 90;
+
+} // namespace
+
+ImageGridDiskCache::ImageGridDiskCache(const QString &directory, const qint64 maxBytes) :
+    directory_(directory.isEmpty() ?
+                   QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                   + QStringLiteral("/thumbnails") :
+                   directory),
+    maxBytes_(maxBytes),
+    bytes_(-1),
+    mutex_()
+{
+    if(!QDir().mkpath(directory_)) {
+        qWarning("ImageGridDiskCache::ImageGridDiskCache: Can't create %s",
+                 qPrintable(directory_));
+    }
+}
+
+int ImageGridDiskCache::bucket(const int side)
+{
+    auto bucket = MinBucket;
+    while(bucket < side) {
+        bucket *= 2;
+    }
+
+    return bucket;
+}
+
+QString ImageGridDiskCache::directory() const
+{
+    return directory_;
+}
+
+bool ImageGridDiskCache::isValid() const
+{
+    return QFileInfo(directory_).isDir();
+}
+
+qint64 ImageGridDiskCache::maxBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return maxBytes_;
+}
+
+void ImageGridDiskCache::setMaxBytes(const qint64 bytes)
+{
+    if(bytes < 0) {
+        qWarning("ImageGridDiskCache::setMaxBytes: Negative size: %lld", bytes);
+        return;
+    }
+
+    QMutexLocker locker(&mutex_);
+    maxBytes_ = bytes;
+    countBytes();
+    if(bytes_ > maxBytes_) {
+        evict();
+    }
+}
+
+qint64 ImageGridDiskCache::bytes() const
+{
+    QMutexLocker locker(&mutex_);
+    countBytes();
+    return bytes_;
+}
+
+QString ImageGridDiskCache::fileName(const QString &path, const int side) const
+{
+    const QFileInfo info(path);
+    if(!info.exists()) {
+        return {};
+    }
+
+    // Editing the file changes its time or size and so its thumbnails
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(info.size()));
+    return QStringLiteral("%1/%2-%3.png").arg(directory_,
+                                              QString::fromLatin1(hash.result().toHex()),
+                                              QString::number(side));
+}
+
+void ImageGridDiskCache::countBytes() const
+{
+    if(bytes_ >= 0) {
+        return;
+    }
+
+    bytes_ = 0;
+    const QFileInfoList files = QDir(directory_).entryInfoList(QStringList("*.png"),
+                                                               QDir::Files);
+    for(const QFileInfo &file : files) {
+        bytes_ += file.size();
+    }
+}
+
+void ImageGridDiskCache::evict()
+{
+    // Least recently used first, find() touches the thumbnails it reads
+    const QFileInfoList files = QDir(directory_).entryInfoList(QStringList("*.png"),
+                                                               QDir::Files,
+                                                               QDir::Time | QDir::Reversed);
+    const auto target = maxBytes_ - maxBytes_ / 4;
+    for(const QFileInfo &file : files) {
+        if(bytes_ <= target) {
+            break;
+        }
+
+        if(QFile::remove(file.absoluteFilePath())) {
+            bytes_ -= file.size();
+        }
+    }
+}
+
+QImage ImageGridDiskCache::find(const QString &path, const int side) const
+{
+    const QString name = fileName(path, side);
+    if(name.isEmpty() || !QFile::exists(name)) {
+        return {};
+    }
+
+    QImageReader reader(name, "png");
+    const QImage image = reader.read();
+    if(image.isNull()) {
+        qWarning("ImageGridDiskCache::find: %s: %s", qPrintable(name),
+                 qPrintable(reader.errorString()));
+        return image;
+    }
+
+    // Eviction goes by modification time, a hit makes the thumbnail recent
+    QFile file(name);
+    if(file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    return image;
+}
+
+bool ImageGridDiskCache::insert(const QString &path, const int side, const QImage &image)
+{
+    if(image.isNull()) {
+        qWarning("ImageGridDiskCache::insert: Null image");
+        return false;
+    }
+
+    const QString name = fileName(path, side);
+    if(name.isEmpty()) {
+        qWarning("ImageGridDiskCache::insert: No such file: %s", qPrintable(path));
+        return false;
+    }
+
+    // Readers on other threads never see a half written thumbnail
+    QSaveFile file(name);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning("ImageGridDiskCache::insert: %s", qPrintable(file.errorString()));
+        return false;
+    }
+
+    QImageWriter writer(&file, "png");
+    writer.setQuality(PngQuality);
+    if(!writer.write(image)) {
+        qWarning("ImageGridDiskCache::insert: %s", qPrintable(writer.errorString()));
+        file.cancelWriting();
+        return false;
+    }
+
+    // A thumbnail written again replaces the old file, which no longer counts
+    const auto written = file.size();
+    QMutexLocker locker(&mutex_);
+    countBytes();
+    const QFileInfo old(name);
+    const auto replaced = old.exists() ? old.size() : 0;
+    if(!file.commit()) {
+        qWarning("ImageGridDiskCache::insert: %s", qPrintable(file.errorString()));
+        return false;
+    }
+
+    bytes_ += written - replaced;
+    if(bytes_ > maxBytes_) {
+        evict();
+    }
+
+    return true;
+}
+
+QImage ImageGridDiskCache::read(const QString &path, const int side)
+{
+    const auto longest = bucket(side);
+    QImage image = find(path, longest);
+    if(!image.isNull()) {
+        return image;
+    }
+
+    QImageReader reader(path);
+    const QSize size = reader.size();
+    if(size.isValid() && qMax(size.width(), size.height()) > longest) {
+        reader.setScaledSize(size.scaled(longest, longest, Qt::KeepAspectRatio));
+    }
+
+    image = reader.read();
+    if(image.isNull()) {
+        qWarning("ImageGridDiskCache::read: %s: %s", qPrintable(path),
+                 qPrintable(reader.errorString()));
+        return {};
+    }
+
+    insert(path, longest, image);
+    return image;
+}
+
+void ImageGridDiskCache::clear()
+{
+    QMutexLocker locker(&mutex_);
+    const QFileInfoList files = QDir(directory_).entryInfoList(QStringList("*.png"),
+                                                               QDir::Files);
+    for(const QFileInfo &file : files) {
+        QFile::remove(file.absoluteFilePath());
+    }
+
+    bytes_ = 0;
+}
@@ -0,0 +1,166 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDDISKCACHE_HPP
+#define IMAGEGRIDDISKCACHE_HPP
+
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Thumbnails of image files kept on disk between runs
+ *
+ * Thumbnails are stored as PNG files named after a hash of the file's
+ * absolute path, modification time and size, and a bucket for the
+ * thumbnail size. Buckets are powers of two of the longest side, so a
+ * thumbnail is reused for every tile size up to its bucket and a file
+ * that changes on disk misses the cache instead of showing stale pixels.
+ *
+ * Once the thumbnails take more than maxBytes() the least recently used
+ * ones are removed until a quarter of the budget is free again. Reading
+ * a thumbnail updates its modification time, which is what eviction
+ * goes by.
+ *
+ * All functions are thread-safe.
+ */
+class ImageGridDiskCache
+{
+    //! Directory the thumbnails are stored in
+    QString directory_;
+
+    //! Budget for all thumbnails in bytes
+    qint64 maxBytes_;
+
+    //! Bytes used by the thumbnails, -1 until counted
+    mutable qint64 bytes_;
+
+    //! Guards bytes_ and eviction
+    mutable QMutex mutex_;
+
+    /**
+     * @brief Get the thumbnail file of an image file
+     * @param path Image file
+     * @param side Bucket of the thumbnail
+     * @return Thumbnail file or empty string if the image file doesn't exist
+     */
+    QString fileName(const QString &path, int side) const;
+
+    /**
+     * @brief Add up the size of every thumbnail if not done yet
+     *
+     * The mutex must be locked
+     */
+    void countBytes() const;
+
+    /**
+     * @brief Remove the least recently used thumbnails until the budget has room again
+     *
+     * The mutex must be locked
+     */
+    void evict();
+
+public:
+    /**
+     * @brief Constructor
+     * @param directory Directory to store thumbnails in, defaults to
+     * "thumbnails" in the application's cache location (the XDG cache
+     * directory on Linux)
+     * @param maxBytes Budget for all thumbnails in bytes
+     */
+    explicit ImageGridDiskCache(const QString &directory = QString(),
+                                qint64 maxBytes = 256 * 1024 * 1024);
+
+    /**
+     * @brief Round a thumbnail size up to the bucket it's stored in
+     * @param side Longest side in pixels
+     * @return Bucket, a power of two of at least 64
+     */
+    static int bucket(int side);
+
+    /**
+     * @brief Get the directory thumbnails are stored in
+     * @return Directory
+     */
+    QString directory() const;
+
+    /**
+     * @brief Check if the directory could be created
+     * @return True if thumbnails can be stored
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Get budget for all thumbnails
+     * @return Budget in bytes
+     */
+    qint64 maxBytes() const;
+
+    /**
+     * @brief Set budget for all thumbnails
+     *
+     * Removes the least recently used thumbnails if they take more
+     * @param bytes Budget in bytes
+     */
+    void setMaxBytes(qint64 bytes);
+
+    /**
+     * @brief Get the space taken by the thumbnails
+     * @return Bytes
+     */
+    qint64 bytes() const;
+
+    /**
+     * @brief Find the thumbnail of an image file
+     * @param path Image file
+     * @param side Bucket of the thumbnail, see bucket()
+     * @return Thumbnail or null image if not cached
+     */
+    QImage find(const QString &path, int side) const;
+
+    /**
+     * @brief Store the thumbnail of an image file
+     * @param path Image file
+     * @param side Bucket of the thumbnail, see bucket()
+     * @param image Thumbnail, its longest side should be side
+     * @return True if stored
+     */
+    bool insert(const QString &path, int side, const QImage &image);
+
+    /**
+     * @brief Get the thumbnail of an image file, decoding and storing it if needed
+     * @param path Image file
+     * @param side Longest side the thumbnail must have at least
+     * @return Thumbnail with the longest side of bucket(side) or less,
+     * or null image if the file can't be read
+     */
+    QImage read(const QString &path, int side);
+
+    /**
+     * @brief Remove every thumbnail
+     */
+    void clear();
+};
+
+#endif // IMAGEGRIDDISKCACHE_HPP
@@ -0,0 +1,274 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <algorithm>
+#include <QtGlobal>
+#include "imagegridgeometry.hpp"
+
+namespace {
+
+QVector<int> cumulativeEnds(const QVector<int> &widths, const int spacing) {
+    QVector<int> ends;
+    ends.reserve(widths.size());
+    auto x = 0;
+    for(const auto w : widths) {
+        x += w + spacing;
+        ends.append(x);
+    }
+
+    return ends;
+}
+
+} // namespace
+
+ImageGridGeometry::ImageGridGeometry() :
+    rowHeights_(),
+    columnEnds_(),
+    rowEnds_(),
+    widthCounts_(),
+    staleRow_(0),
+    spacing_(0)
+{
+
+}
+
+void ImageGridGeometry::updateOffsets() const
+{
+    const auto rows = rowHeights_.size();
+    if(staleRow_ >= rows && rowEnds_.size() == rows) {
+        return;
+    }
+
+    rowEnds_.resize(rows);
+    auto y = staleRow_ == 0 ? 0 : rowEnds_.at(staleRow_ - 1);
+    for(auto row = staleRow_; row < rows; ++row) {
+        y += rowHeights_.at(row) + spacing_;
+        rowEnds_[row] = y;
+    }
+
+    staleRow_ = rows;
+}
+
+void ImageGridGeometry::addWidth(const QVector<int> &ends)
+{
+    ++widthCounts_[ends.isEmpty() ? 0 : ends.last()];
+}
+
+void ImageGridGeometry::removeWidth(const QVector<int> &ends)
+{
+    const auto it = widthCounts_.find(ends.isEmpty() ? 0 : ends.last());
+    Q_ASSERT(it != widthCounts_.end());
+    if(--it.value() == 0) {
+        widthCounts_.erase(it);
+    }
+}
+
+void ImageGridGeometry::invalidate(const int row)
+{
+    staleRow_ = qMin(staleRow_, row);
+}
+
+void ImageGridGeometry::reset(const int spacing)
+{
+    rowHeights_.clear();
+    columnEnds_.clear();
+    rowEnds_.clear();
+    widthCounts_.clear();
+    staleRow_ = 0;
+    spacing_ = spacing;
+}
+
+void ImageGridGeometry::appendRow(const int height, const QVector<int> &widths)
+{
+    invalidate(rowHeights_.size());
+    rowHeights_.append(height);
+    columnEnds_.append(cumulativeEnds(widths, spacing_));
+    addWidth(columnEnds_.last());
+}
+
+void ImageGridGeometry::insertRow(const int row)
+{
+    if(row < 0 || row > rowHeights_.size()) {
+        qWarning("ImageGridGeometry::insertRow: Invalid row: %d", row);
+        return;
+    }
+
+    invalidate(row);
+    rowHeights_.insert(row, 0);
+    columnEnds_.insert(row, QVector<int>());
+    addWidth(QVector<int>());
+}
+
+void ImageGridGeometry::removeRow(const int row)
+{
+    if(row < 0 || row >= rowHeights_.size()) {
+        qWarning("ImageGridGeometry::removeRow: Invalid row: %d", row);
+        return;
+    }
+
+    invalidate(row);
+    removeWidth(columnEnds_.at(row));
+    rowHeights_.remove(row);
+    columnEnds_.remove(row);
+}
+
+void ImageGridGeometry::removeRows(const QVector<int> &rows)
+{
+    if(rows.isEmpty()) {
+        return;
+    }
+
+    if(rows.first() < 0 || rows.last() >= rowHeights_.size()) {
+        qWarning("ImageGridGeometry::removeRows: Invalid rows: %d-%d",
+                 rows.first(), rows.last());
+        return;
+    }
+
+    // Kept rows move up over the removed ones
+    invalidate(rows.first());
+    auto next = 0;
+    auto kept = rows.first();
+    for(auto row = rows.first(); row < rowHeights_.size(); ++row) {
+        if(next < rows.size() && rows.at(next) == row) {
+            removeWidth(columnEnds_.at(row));
+            ++next;
+            continue;
+        }
+
+        rowHeights_[kept] = rowHeights_.at(row);
+        columnEnds_[kept] = columnEnds_.at(row);
+        ++kept;
+    }
+
+    rowHeights_.resize(kept);
+    columnEnds_.resize(kept);
+}
+
+void ImageGridGeometry::setRow(const int row, const int height,
+                               const QVector<int> &widths)
+{
+    if(row < 0 || row >= rowHeights_.size()) {
+        qWarning("ImageGridGeometry::setRow: Invalid row: %d", row);
+        return;
+    }
+
+    invalidate(row);
+    rowHeights_[row] = height;
+    removeWidth(columnEnds_.at(row));
+    columnEnds_[row] = cumulativeEnds(widths, spacing_);
+    addWidth(columnEnds_.at(row));
+}
+
+int ImageGridGeometry::spacing() const
+{
+    return spacing_;
+}
+
+int ImageGridGeometry::rowCount() const
+{
+    return rowHeights_.size();
+}
+
+int ImageGridGeometry::columnCount(const int row) const
+{
+    if(row < 0 || row >= columnEnds_.size()) {
+        return 0;
+    }
+
+    return columnEnds_.at(row).size();
+}
+
+int ImageGridGeometry::width() const
+{
+    return widthCounts_.isEmpty() ? 0 : widthCounts_.lastKey();
+}
+
+int ImageGridGeometry::height() const
+{
+    updateOffsets();
+
+    return rowEnds_.isEmpty() ? 0 : rowEnds_.last();
+}
+
+int ImageGridGeometry::rowHeight(const int row) const
+{
+    if(row < 0 || row >= rowHeights_.size()) {
+        return 0;
+    }
+
+    return rowHeights_.at(row);
+}
+
+int ImageGridGeometry::columnWidth(const int row, const int column) const
+{
+    if(column < 0 || column >= columnCount(row)) {
+        return 0;
+    }
+
+    const QVector<int> &ends = columnEnds_.at(row);
+    const auto left = column == 0 ? 0 : ends.at(column - 1);
+    return ends.at(column) - left - spacing_;
+}
+
+QRect ImageGridGeometry::tileRect(const int row, const int column) const
+{
+    if(column < 0 || column >= columnCount(row)) {
+        return {};
+    }
+
+    updateOffsets();
+
+    const auto top = row == 0 ? 0 : rowEnds_.at(row - 1);
+    const QVector<int> &ends = columnEnds_.at(row);
+    const auto left = column == 0 ? 0 : ends.at(column - 1);
+    return QRect(left, top, ends.at(column) - left - spacing_, rowHeights_.at(row));
+}
+
+QPair<int, int> ImageGridGeometry::vertical(const int y) const
+{
+    updateOffsets();
+
+    const auto it = std::lower_bound(rowEnds_.cbegin(), rowEnds_.cend(), y);
+    if(it == rowEnds_.cend()) {
+        return qMakePair(height(), rowEnds_.size());
+    }
+
+    return qMakePair(*it, static_cast<int>(it - rowEnds_.cbegin()));
+}
+
+QPair<int, int> ImageGridGeometry::horizontal(const int row, const int x) const
+{
+    if(row < 0 || row >= columnEnds_.size()) {
+        qWarning("ImageGridGeometry::horizontal: Invalid row: %d", row);
+        return {};
+    }
+
+    const QVector<int> &ends = columnEnds_.at(row);
+    const auto it = std::lower_bound(ends.cbegin(), ends.cend(), x);
+    if(it == ends.cend()) {
+        return qMakePair(ends.isEmpty() ? 0 : ends.last(), ends.size());
+    }
+
+    return qMakePair(*it, static_cast<int>(it - ends.cbegin()));
+}
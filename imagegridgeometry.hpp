@@ -0,0 +1,212 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDGEOMETRY_HPP
+#define IMAGEGRIDGEOMETRY_HPP
+
+#include <QMap>
+#include <QPair>
+#include <QRect>
+#include <QVector>
+
+/**
+ * @brief Cached tile geometry of an image grid
+ *
+ * Stores cumulative row bottoms and per-row cumulative column ends
+ * (both including the trailing spacing) so that the row and column
+ * under a point can be found with a binary search instead of walking
+ * the layout.
+ *
+ * Rows can be inserted, removed and replaced individually. The row
+ * offsets below the first changed row are recomputed on the next query.
+ * The width of the widest row is kept up to date as rows change, so
+ * changing one row doesn't look at the others.
+ */
+class ImageGridGeometry
+{
+    //! Height of each row, excluding spacing
+    QVector<int> rowHeights_;
+
+    //! Cumulative right edge of each column per row, including spacing
+    QVector<QVector<int>> columnEnds_;
+
+    //! Cumulative bottom edge of each row, including spacing
+    mutable QVector<int> rowEnds_;
+
+    //! Number of rows of each width, including spacing
+    QMap<int, int> widthCounts_;
+
+    //! First row whose offsets are out of date
+    mutable int staleRow_;
+
+    //! Space between tiles and rows in pixels
+    int spacing_;
+
+    /**
+     * @brief Recompute row offsets from the first stale row
+     */
+    void updateOffsets() const;
+
+    /**
+     * @brief Count a row in widthCounts_
+     * @param ends Cumulative column ends of the row
+     */
+    void addWidth(const QVector<int> &ends);
+
+    /**
+     * @brief Stop counting a row in widthCounts_
+     * @param ends Cumulative column ends of the row
+     */
+    void removeWidth(const QVector<int> &ends);
+
+    /**
+     * @brief Mark offsets stale from row
+     * @param row First changed row
+     */
+    void invalidate(int row);
+
+public:
+    /**
+     * @brief Constructor
+     */
+    ImageGridGeometry();
+
+    /**
+     * @brief Remove all rows
+     * @param spacing Space between tiles and rows in pixels
+     */
+    void reset(int spacing);
+
+    /**
+     * @brief Append a row to the bottom
+     * @param height Height of the row in pixels
+     * @param widths Widths of the tiles on the row in pixels
+     */
+    void appendRow(int height, const QVector<int> &widths);
+
+    /**
+     * @brief Insert an empty row before row
+     *
+     * The row must be filled in with setRow()
+     * @param row Row to insert before, may be equal to rowCount()
+     */
+    void insertRow(int row);
+
+    /**
+     * @brief Remove a row
+     * @param row Row to remove
+     */
+    void removeRow(int row);
+
+    /**
+     * @brief Remove several rows in a single pass
+     * @param rows Rows to remove in ascending order
+     */
+    void removeRows(const QVector<int> &rows);
+
+    /**
+     * @brief Replace the sizes of a row
+     * @param row Row
+     * @param height Height of the row in pixels
+     * @param widths Widths of the tiles on the row in pixels
+     */
+    void setRow(int row, int height, const QVector<int> &widths);
+
+    /**
+     * @brief Get space between tiles and rows
+     * @return Spacing in pixels
+     */
+    int spacing() const;
+
+    /**
+     * @brief Get number of rows
+     * @return Number of rows
+     */
+    int rowCount() const;
+
+    /**
+     * @brief Get number of columns for a row
+     * @param row Row
+     * @return Number of columns or 0 if row is invalid
+     */
+    int columnCount(int row) const;
+
+    /**
+     * @brief Get width of the widest row
+     * @return Width in pixels, including spacing
+     */
+    int width() const;
+
+    /**
+     * @brief Get height of all rows
+     * @return Height in pixels, including spacing
+     */
+    int height() const;
+
+    /**
+     * @brief Get height of a row
+     * @param row Row
+     * @return Height in pixels, excluding spacing
+     */
+    int rowHeight(int row) const;
+
+    /**
+     * @brief Get width of a tile
+     * @param row Row
+     * @param column Column
+     * @return Width in pixels, excluding spacing
+     */
+    int columnWidth(int row, int column) const;
+
+    /**
+     * @brief Get the area of a tile
+     * @param row Row
+     * @param column Column
+     * @return Area excluding spacing or null rect if index is invalid
+     */
+    QRect tileRect(int row, int column) const;
+
+    /**
+     * @brief Find the row at y
+     *
+     * Returns rowCount() as the index and height() as the edge
+     * if y is below the last row
+     * @param y Vertical position
+     * @return Bottom edge (including spacing) and index of the row
+     */
+    QPair<int, int> vertical(int y) const;
+
+    /**
+     * @brief Find the column at x on a row
+     *
+     * Returns columnCount() as the index and the row width as the edge
+     * if x is right of the last column
+     * @param row Row to search
+     * @param x Horizontal position
+     * @return Right edge (including spacing) and index of the column
+     */
+    QPair<int, int> horizontal(int row, int x) const;
+};
+
+#endif // IMAGEGRIDGEOMETRY_HPP
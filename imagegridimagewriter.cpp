@@ -0,0 +1,193 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QRgb>
+#include "imagegridimagewriter.hpp"
+
+namespace {
+
+// BMP rows are padded to a multiple of four bytes
+int bmpStride(const int width) {
+    return (width * 3 + 3) & ~3;
+}
+
+} // namespace
+
+ImageGridImageWriter::ImageGridImageWriter(const QString &fileName) :
+    file_(fileName),
+    format_(formatForFileName(fileName)),
+    size_(),
+    linesWritten_(0),
+    line_(),
+    errorString_()
+{
+
+}
+
+ImageGridImageWriter::Format ImageGridImageWriter::formatForFileName(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if(suffix == QLatin1String("ppm")) {
+        return PpmFormat;
+    }
+    else if(suffix == QLatin1String("bmp")) {
+        return BmpFormat;
+    }
+
+    return UnknownFormat;
+}
+
+bool ImageGridImageWriter::open(const QSize &size)
+{
+    if(format_ == UnknownFormat) {
+        errorString_ = QStringLiteral("Unsupported format: %1").arg(file_.fileName());
+        return false;
+    }
+
+    if(size.isEmpty()) {
+        errorString_ = QStringLiteral("Empty image");
+        return false;
+    }
+
+    if(format_ == BmpFormat
+            && static_cast<qint64>(bmpStride(size.width())) * size.height() > 0xFFFFFFFFLL - 54) {
+        errorString_ = QStringLiteral("Image too large for BMP");
+        return false;
+    }
+
+    if(!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString_ = file_.errorString();
+        return false;
+    }
+
+    size_ = size;
+    linesWritten_ = 0;
+    line_.resize(format_ == BmpFormat ? bmpStride(size.width()) : size.width() * 3);
+    line_.fill(0);
+
+    return writeHeader();
+}
+
+bool ImageGridImageWriter::writeHeader()
+{
+    if(format_ == PpmFormat) {
+        const QByteArray header = QByteArray("P6\n") + QByteArray::number(size_.width())
+                + ' ' + QByteArray::number(size_.height()) + "\n255\n";
+        if(file_.write(header) != header.size()) {
+            errorString_ = file_.errorString();
+            return false;
+        }
+
+        return true;
+    }
+
+    const quint32 imageSize = static_cast<quint32>(line_.size()) * size_.height();
+    QDataStream out(&file_);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    // BITMAPFILEHEADER
+    out << quint8('B') << quint8('M') << quint32(54 + imageSize)
+        << quint32(0) << quint32(54);
+
+    // BITMAPINFOHEADER, negative height means top-down
+    out << quint32(40) << qint32(size_.width()) << qint32(-size_.height())
+        << quint16(1) << quint16(24) << quint32(0) << imageSize
+        << qint32(2835) << qint32(2835) << quint32(0) << quint32(0);
+
+    if(out.status() != QDataStream::Ok) {
+        errorString_ = file_.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageGridImageWriter::write(const QImage &band)
+{
+    if(!file_.isOpen()) {
+        errorString_ = QStringLiteral("File is not open");
+        return false;
+    }
+
+    if(band.width() != size_.width()) {
+        errorString_ = QStringLiteral("Band width %1 does not match image width %2")
+                .arg(band.width()).arg(size_.width());
+        return false;
+    }
+
+    if(linesWritten_ + band.height() > size_.height()) {
+        errorString_ = QStringLiteral("Too many scanlines");
+        return false;
+    }
+
+    const QImage rgb = band.format() == QImage::Format_RGB32
+            || band.format() == QImage::Format_ARGB32 ?
+                band : band.convertToFormat(QImage::Format_RGB32);
+
+    // PPM stores red first and BMP blue first
+    const auto bmp = format_ == BmpFormat;
+    const auto width = size_.width();
+    for(auto y = 0; y < rgb.height(); ++y) {
+        const QRgb *src = reinterpret_cast<const QRgb *>(rgb.constScanLine(y));
+        char *dst = line_.data();
+        for(auto x = 0; x < width; ++x) {
+            const QRgb px = src[x];
+            *dst++ = static_cast<char>(bmp ? qBlue(px) : qRed(px));
+            *dst++ = static_cast<char>(qGreen(px));
+            *dst++ = static_cast<char>(bmp ? qRed(px) : qBlue(px));
+        }
+
+        if(file_.write(line_) != line_.size()) {
+            errorString_ = file_.errorString();
+            return false;
+        }
+    }
+
+    linesWritten_ += rgb.height();
+    return true;
+}
+
+bool ImageGridImageWriter::close()
+{
+    if(!file_.isOpen()) {
+        errorString_ = QStringLiteral("File is not open");
+        return false;
+    }
+
+    file_.close();
+    if(linesWritten_ != size_.height()) {
+        errorString_ = QStringLiteral("Wrote %1 of %2 scanlines")
+                .arg(linesWritten_).arg(size_.height());
+        return false;
+    }
+
+    return true;
+}
+
+QString ImageGridImageWriter::errorString() const
+{
+    return errorString_;
+}
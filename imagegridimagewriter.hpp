@@ -0,0 +1,121 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDIMAGEWRITER_HPP
+#define IMAGEGRIDIMAGEWRITER_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+/**
+ * @brief Writes an image to a file a band of scanlines at a time
+ *
+ * Unlike QImageWriter the whole image never has to be in memory.
+ * The format is chosen by file suffix: binary PPM (.ppm) or
+ * uncompressed 24-bit top-down BMP (.bmp).
+ */
+class ImageGridImageWriter
+{
+public:
+    //! Supported file formats
+    enum Format {
+        UnknownFormat,
+        PpmFormat,
+        BmpFormat
+    };
+
+private:
+    //! Output file
+    QFile file_;
+
+    //! Output format
+    Format format_;
+
+    //! Size of the whole image
+    QSize size_;
+
+    //! Number of scanlines written so far
+    int linesWritten_;
+
+    //! Buffer for one encoded scanline
+    QByteArray line_;
+
+    //! Description of the last error
+    QString errorString_;
+
+    /**
+     * @brief Write the file header
+     * @return True on success
+     */
+    bool writeHeader();
+
+public:
+    /**
+     * @brief Constructor
+     * @param fileName File to write
+     */
+    explicit ImageGridImageWriter(const QString &fileName);
+
+    /**
+     * @brief Get format for a file name
+     * @param fileName File name
+     * @return Format or UnknownFormat if the suffix is not supported
+     */
+    static Format formatForFileName(const QString &fileName);
+
+    /**
+     * @brief Open the file and write the header
+     * @param size Size of the whole image
+     * @return True on success
+     */
+    bool open(const QSize &size);
+
+    /**
+     * @brief Append scanlines to the image
+     *
+     * The band must be as wide as the image
+     * @param band Scanlines to append, top to bottom
+     * @return True on success
+     */
+    bool write(const QImage &band);
+
+    /**
+     * @brief Finish writing and close the file
+     *
+     * Fails if fewer scanlines were written than the image height
+     * @return True on success
+     */
+    bool close();
+
+    /**
+     * @brief Get description of the last error
+     * @return Error string
+     */
+    QString errorString() const;
+};
+
+#endif // IMAGEGRIDIMAGEWRITER_HPP
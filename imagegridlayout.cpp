@@ -0,0 +1,388 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <limits>
+#include <QPair>
+#include <QtGlobal>
+#include "imagegridgeometry.hpp"
+#include "imagegridlayout.hpp"
+#include "imagegridmodel.hpp"
+
+namespace {
+
+template <class T>
+T calculateHeight(const QSize &img, const T newWidth) {
+    return static_cast<double>(img.height()) / img.width() * newWidth;
+}
+
+double aspectRatio(const QSize &img) {
+    return img.isEmpty() ? 1.0 : static_cast<double>(img.width()) / img.height();
+}
+
+ImageGridLayout::Side getWidth(const QPoint &needle, const QSize &haystack) {
+    const auto midW = haystack.width() / 2;
+    if(needle.x() < midW) {
+        return ImageGridLayout::Left;
+    }
+    else {
+        return ImageGridLayout::Right;
+    }
+}
+
+ImageGridLayout::Side getHeight(const QPoint &needle, const QSize &haystack) {
+    const auto midH = haystack.height() / 2;
+    if(needle.y() < midH) {
+        return ImageGridLayout::Top;
+    }
+    else {
+        return ImageGridLayout::Bottom;
+    }
+}
+
+} // namespace
+
+ImageGridLayout::ImageGridLayout(const int width, const int spacing,
+                                 const QSize &referenceSize) :
+    width_(width),
+    spacing_(spacing),
+    referenceSize_(referenceSize),
+    mode_(UniformRows)
+{
+
+}
+
+int ImageGridLayout::width() const
+{
+    return width_;
+}
+
+void ImageGridLayout::setWidth(const int width)
+{
+    if(width < 0) {
+        qWarning("ImageGridLayout::setWidth: Negative width: %d", width);
+        return;
+    }
+
+    width_ = width;
+}
+
+int ImageGridLayout::spacing() const
+{
+    return spacing_;
+}
+
+void ImageGridLayout::setSpacing(const int spacing)
+{
+    if(spacing < 0) {
+        qWarning("ImageGridLayout::setSpacing: Negative spacing: %d", spacing);
+        return;
+    }
+
+    spacing_ = spacing;
+}
+
+QSize ImageGridLayout::referenceSize() const
+{
+    return referenceSize_;
+}
+
+void ImageGridLayout::setReferenceSize(const QSize &size)
+{
+    referenceSize_ = size;
+}
+
+ImageGridLayout::Mode ImageGridLayout::mode() const
+{
+    return mode_;
+}
+
+void ImageGridLayout::setMode(const Mode mode)
+{
+    mode_ = mode;
+}
+
+int ImageGridLayout::layoutWidth() const
+{
+    return width_ > 0 ? width_ : referenceSize_.width();
+}
+
+QSize ImageGridLayout::rowSize(const int columns) const
+{
+    if(columns <= 0 || referenceSize_.isEmpty()) {
+        return {};
+    }
+
+    const auto rowSpacing = (columns - 1) * spacing_;
+    const auto widthWithoutSpacing = layoutWidth() - rowSpacing;
+    const auto rowImgWidth = widthWithoutSpacing / columns;
+    return QSize(rowImgWidth, calculateHeight(referenceSize_, rowImgWidth));
+}
+
+QSize ImageGridLayout::tileSize(const int column, const int columns) const
+{
+    const QSize size = rowSize(columns);
+    if(column + 1 != columns) {
+        return size;
+    }
+
+    // The last image on a row is widened to fill the layout width
+    const auto pixelsTaken = (columns * size.width()) + (column * spacing_);
+    return QSize(size.width() + layoutWidth() - pixelsTaken, size.height());
+}
+
+QVector<QSize> ImageGridLayout::rowSizes(const QVector<QSize> &images) const
+{
+    const auto columns = images.size();
+    QVector<QSize> sizes;
+    sizes.reserve(columns);
+    if(mode_ == UniformRows) {
+        for(auto col = 0; col < columns; ++col) {
+            sizes.append(tileSize(col, columns));
+        }
+
+        return sizes;
+    }
+
+    auto aspectSum = 0.0;
+    for(const QSize &image : images) {
+        aspectSum += aspectRatio(image);
+    }
+
+    const auto available = layoutWidth() - (columns - 1) * spacing_;
+    if(columns == 0 || available <= 0) {
+        return sizes;
+    }
+
+    // Round the running edge instead of each width so the row stays
+    // exactly as wide as the layout
+    const auto height = qMax(1, qRound(available / aspectSum));
+    auto aspect = 0.0;
+    auto left = 0;
+    for(const QSize &image : images) {
+        aspect += aspectRatio(image);
+        const auto right = qRound(available * aspect / aspectSum);
+        sizes.append(QSize(right - left, height));
+        left = right;
+    }
+
+    return sizes;
+}
+
+QVector<QSize> ImageGridLayout::rowSizes(const ImageGridModel &model, const int row) const
+{
+    const auto columns = model.columnCount(row);
+    QVector<QSize> images;
+    images.reserve(columns);
+    for(auto col = 0; col < columns; ++col) {
+        images.append(model.sizeAt(row, col));
+    }
+
+    return rowSizes(images);
+}
+
+QVector<int> ImageGridLayout::partition(const QVector<QSize> &images,
+                                        const int targetHeight) const
+{
+    if(targetHeight <= 0) {
+        qWarning("ImageGridLayout::partition: Invalid target height: %d", targetHeight);
+        return {};
+    }
+
+    const auto count = images.size();
+    const auto width = layoutWidth();
+    const auto minHeight = targetHeight / 2.0;
+
+    // cost[i] is the best cost of laying out the first i images and
+    // start[i] the first image on the last of those rows
+    QVector<double> cost(count + 1, std::numeric_limits<double>::max());
+    QVector<int> start(count + 1, 0);
+    cost[0] = 0;
+    for(auto end = 1; end <= count; ++end) {
+        auto aspectSum = 0.0;
+        for(auto first = end - 1; first >= 0; --first) {
+            aspectSum += aspectRatio(images.at(first));
+            const auto columns = end - first;
+            const auto height = (width - (columns - 1) * spacing_) / aspectSum;
+            if(columns > 1 && height < minHeight) {
+                break;
+            }
+
+            const auto rowCost = cost.at(first) + (height - targetHeight) * (height - targetHeight);
+            if(rowCost < cost.at(end)) {
+                cost[end] = rowCost;
+                start[end] = first;
+            }
+        }
+    }
+
+    QVector<int> columns;
+    for(auto end = count; end > 0; end = start.at(end)) {
+        columns.prepend(end - start.at(end));
+    }
+
+    return columns;
+}
+
+QVector<QVector<QRect>> ImageGridLayout::tileRects(const ImageGridModel &model) const
+{
+    const auto rows = model.rowCount();
+    QVector<QVector<QRect>> rects;
+    rects.reserve(rows);
+    auto y = 0;
+    for(auto row = 0; row < rows; ++row) {
+        const QVector<QSize> sizes = rowSizes(model, row);
+        QVector<QRect> rowRects;
+        rowRects.reserve(sizes.size());
+        auto x = 0;
+        for(const QSize &size : sizes) {
+            rowRects.append(QRect(QPoint(x, y), size));
+            x += size.width() + spacing_;
+        }
+
+        y += (sizes.isEmpty() ? 0 : sizes.first().height()) + spacing_;
+        rects.append(rowRects);
+    }
+
+    return rects;
+}
+
+QSize ImageGridLayout::size(const ImageGridModel &model) const
+{
+    const auto rows = model.rowCount();
+    if(rows == 0) {
+        return {};
+    }
+
+    auto height = (rows - 1) * spacing_;
+    for(auto row = 0; row < rows; ++row) {
+        height += rowHeight(model, row);
+    }
+
+    return QSize(layoutWidth(), height);
+}
+
+int ImageGridLayout::rowHeight(const ImageGridModel &model, const int row) const
+{
+    if(mode_ == UniformRows) {
+        return rowSize(model.columnCount(row)).height();
+    }
+
+    const QVector<QSize> sizes = rowSizes(model, row);
+    return sizes.isEmpty() ? 0 : sizes.first().height();
+}
+
+ImageGridLayout::Side ImageGridLayout::side(const QPoint &needle, const QSize &haystack)
+{
+    const auto x = getWidth(needle, haystack);
+    const auto y = getHeight(needle, haystack);
+    if(x == Left && y == Top) {
+        // top-left
+        const auto diagonalPixelHorizontal = needle.y() * 2;
+        if(needle.x() > diagonalPixelHorizontal) {
+            return Top;
+        }
+        else {
+            return Left;
+        }
+    }
+    else if(x == Right && y == Top) {
+        // top-right
+        QPoint tmp(haystack.width() - needle.x(), needle.y());
+        const auto diagonalPixelVertical = tmp.x() / 2;
+        if(tmp.y() < diagonalPixelVertical) {
+            return Top;
+        }
+        else {
+            return Right;
+        }
+    }
+    else if(x == Left && y == Bottom) {
+        // bottom-left
+        QPoint tmp(haystack.width() - needle.x(), needle.y());
+        const auto diagonalPixelVertical = tmp.x() / 2;
+        if(tmp.y() < diagonalPixelVertical) {
+            return Left;
+        }
+        else {
+            return Bottom;
+        }
+    }
+
+    // bottom-right
+    const auto diagonalPixelHorizontal = needle.y() * 2;
+    if(needle.x() > diagonalPixelHorizontal) {
+        return Right;
+    }
+    else {
+        return Bottom;
+    }
+}
+
+ImageGridLayout::DropTarget ImageGridLayout::dropTarget(const ImageGridGeometry &geometry,
+                                                        const QPoint &point)
+{
+    if(geometry.rowCount() == 0) {
+        return DropTarget{0, 0, true};
+    }
+
+    const auto spacing = geometry.spacing();
+
+    const QPair<int, int> v = geometry.vertical(point.y());
+    const auto y = v.first;
+    const auto idx = v.second;
+    if(point.y() > y) {
+        return DropTarget{idx, 0, true};
+    }
+
+    const auto height = geometry.rowHeight(idx) + spacing;
+    // Point relative to the current image
+    auto adjusted = point;
+    adjusted -= QPoint(0, idx == 0 ? 0 : y - height);
+
+    const QPair<int, int> h = geometry.horizontal(idx, point.x());
+    const auto x = h.first;
+    const auto xIdx = h.second;
+    if(point.x() > x) {
+        return DropTarget{idx, xIdx, false};
+    }
+
+    // Get image size for current image
+    const QSize imageSize(geometry.columnWidth(idx, xIdx), geometry.rowHeight(idx));
+    const auto width = imageSize.width() + spacing;
+
+    adjusted -= QPoint(xIdx == 0 ? 0 : x - width, 0);
+
+    switch(side(adjusted, imageSize)) {
+    case Top:
+        return DropTarget{idx, 0, true};
+    case Bottom:
+        return DropTarget{idx + 1, 0, true};
+    case Left:
+        return DropTarget{idx, xIdx, false};
+    case Right:
+        break;
+    }
+
+    return DropTarget{idx, xIdx + 1, false};
+}
@@ -0,0 +1,244 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDLAYOUT_HPP
+#define IMAGEGRIDLAYOUT_HPP
+
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+class ImageGridGeometry;
+class ImageGridModel;
+
+/**
+ * @brief Layout math of an image grid without any widgets
+ *
+ * With UniformRows every image on a row gets the same size. The width
+ * is the layout width minus spacing divided by the number of images,
+ * the height follows the aspect ratio of the reference image (the first
+ * image in the grid) and the last image on a row is widened to absorb
+ * rounding so every row is exactly as wide as the layout.
+ *
+ * With JustifiedRows every image keeps its own aspect ratio. A row gets
+ * the single height at which its images fill the layout width, and
+ * rounding is spread over the row so it is still exactly as wide.
+ */
+class ImageGridLayout
+{
+public:
+    //! Side of an image a point is closest to
+    enum Side {
+        Top, Right, Bottom, Left
+    };
+
+    //! How image sizes on a row are calculated
+    enum Mode {
+        //! Every image is sized like the reference image
+        UniformRows,
+
+        //! Every image keeps its own aspect ratio
+        JustifiedRows
+    };
+
+    //! Where a dropped image goes
+    struct DropTarget {
+        //! Row to insert into, or to insert a new row before
+        int row;
+
+        //! Column to insert before if not inserting a new row
+        int column;
+
+        //! If the image goes on a new row
+        bool newRow;
+    };
+
+private:
+    //! Layout width in pixels, 0 uses the reference image width
+    int width_;
+
+    //! Space between images in pixels
+    int spacing_;
+
+    //! Size of the image the row heights are calculated from
+    QSize referenceSize_;
+
+    //! How image sizes on a row are calculated
+    Mode mode_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param width Layout width in pixels, 0 uses the reference image width
+     * @param spacing Space between images in pixels
+     * @param referenceSize Size of the image row heights are calculated from
+     */
+    explicit ImageGridLayout(int width = 0, int spacing = 0,
+                             const QSize &referenceSize = QSize());
+
+    /**
+     * @brief Get layout width
+     * @return Width in pixels, 0 uses the reference image width
+     */
+    int width() const;
+
+    /**
+     * @brief Set layout width
+     * @param width Width in pixels, 0 uses the reference image width
+     */
+    void setWidth(int width);
+
+    /**
+     * @brief Get space between images
+     * @return Spacing in pixels
+     */
+    int spacing() const;
+
+    /**
+     * @brief Set space between images
+     * @param spacing Spacing in pixels
+     */
+    void setSpacing(int spacing);
+
+    /**
+     * @brief Get size of the reference image
+     * @return Reference size
+     */
+    QSize referenceSize() const;
+
+    /**
+     * @brief Set size of the image row heights are calculated from
+     * @param size Reference size
+     */
+    void setReferenceSize(const QSize &size);
+
+    /**
+     * @brief Get how image sizes on a row are calculated
+     * @return Layout mode
+     */
+    Mode mode() const;
+
+    /**
+     * @brief Set how image sizes on a row are calculated
+     *
+     * Defaults to UniformRows
+     * @param mode Layout mode
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief Get the width rows are laid out to
+     * @return Layout width or the reference image width if it's 0
+     */
+    int layoutWidth() const;
+
+    /**
+     * @brief Calculate image size for a row of uniform images
+     * @param columns Number of images on the row
+     * @return Image size, excluding the extra width of the last image
+     */
+    QSize rowSize(int columns) const;
+
+    /**
+     * @brief Calculate size of an image on a row of uniform images
+     * @param column Column of the image
+     * @param columns Number of images on the row
+     * @return Image size
+     */
+    QSize tileSize(int column, int columns) const;
+
+    /**
+     * @brief Calculate the size of every image on a row
+     *
+     * All images get the same height and fill the layout width
+     * @param images Source image sizes
+     * @return Image sizes in the layout
+     */
+    QVector<QSize> rowSizes(const QVector<QSize> &images) const;
+
+    /**
+     * @brief Calculate the size of every image on a row of a grid
+     * @param model Grid to lay out
+     * @param row Row
+     * @return Image sizes in the layout
+     */
+    QVector<QSize> rowSizes(const ImageGridModel &model, int row) const;
+
+    /**
+     * @brief Calculate the height of a row of a grid
+     * @param model Grid to lay out
+     * @param row Row
+     * @return Height in pixels
+     */
+    int rowHeight(const ImageGridModel &model, int row) const;
+
+    /**
+     * @brief Split images into justified rows close to a target height
+     *
+     * Finds the row breaks that minimize the summed squared difference
+     * between each row's height and the target height. Rows shorter
+     * than half the target are never formed unless they hold a single
+     * image, which keeps the search linear in the number of images.
+     * @param images Source image sizes in grid order
+     * @param targetHeight Preferred row height in pixels
+     * @return Number of images on each row
+     */
+    QVector<int> partition(const QVector<QSize> &images, int targetHeight) const;
+
+    /**
+     * @brief Calculate the area of every image in a grid
+     *
+     * Rows are separated by spacing, with no spacing after the last
+     * row or column
+     * @param model Grid to lay out
+     * @return Areas by row and column
+     */
+    QVector<QVector<QRect>> tileRects(const ImageGridModel &model) const;
+
+    /**
+     * @brief Calculate the size of a grid
+     * @param model Grid to lay out
+     * @return Size with no spacing after the last row or column
+     */
+    QSize size(const ImageGridModel &model) const;
+
+    /**
+     * @brief Find the side of an image a point is closest to
+     * @param point Point relative to the top left corner of the image
+     * @param tile Size of the image
+     * @return Side
+     */
+    static Side side(const QPoint &point, const QSize &tile);
+
+    /**
+     * @brief Find where an image dropped at a point goes
+     * @param geometry Current tile geometry
+     * @param point Drop position
+     * @return Drop target
+     */
+    static DropTarget dropTarget(const ImageGridGeometry &geometry, const QPoint &point);
+};
+
+#endif // IMAGEGRIDLAYOUT_HPP
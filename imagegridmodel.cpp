@@ -0,0 +1,469 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <algorithm>
+#include <QtGlobal>
+#include "imagegridmodel.hpp"
+
+ImageGridModel::ImageGridModel() :
+    rows_(),
+    dirtyCount_(0),
+    tileCount_(0),
+    nextId_(1)
+{
+
+}
+
+ImageGridModel::Tile ImageGridModel::createTile(const QIcon &icon)
+{
+    return Tile{icon, ImageGridSource::fromIcon(icon), nextId_++};
+}
+
+ImageGridModel::Tile ImageGridModel::createTile(const QImage &image)
+{
+    return Tile{QIcon(), ImageGridSource::fromImage(image), nextId_++};
+}
+
+ImageGridModel::Tile ImageGridModel::createTile(const QSharedPointer<ImageGridSource> &source,
+                                                const QIcon &icon, const quint64 id)
+{
+    if(id == 0) {
+        return Tile{icon, source, nextId_++};
+    }
+
+    // Reused ids were handed out earlier, new ones must not collide with them
+    nextId_ = qMax(nextId_, id + 1);
+    return Tile{icon, source, id};
+}
+
+int ImageGridModel::rowCount() const
+{
+    return rows_.size();
+}
+
+int ImageGridModel::columnCount(const int row) const
+{
+    if(row < 0 || row >= rows_.size()) {
+        return 0;
+    }
+
+    return rows_.at(row).tiles.size();
+}
+
+int ImageGridModel::tileCount() const
+{
+    return tileCount_;
+}
+
+bool ImageGridModel::isEmpty() const
+{
+    return tileCount_ == 0;
+}
+
+bool ImageGridModel::isValid(const int row, const int column) const
+{
+    return column >= 0 && column < columnCount(row);
+}
+
+QIcon ImageGridModel::iconAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return {};
+    }
+
+    return rows_.at(row).tiles.at(column).icon;
+}
+
+QImage ImageGridModel::imageAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return {};
+    }
+
+    const Tile &tile = rows_.at(row).tiles.at(column);
+    return tile.source ? tile.source->image() : QImage();
+}
+
+QImage ImageGridModel::imageAt(const int row, const int column, const QSize &size,
+                               const bool keep) const
+{
+    if(!isValid(row, column)) {
+        return {};
+    }
+
+    const Tile &tile = rows_.at(row).tiles.at(column);
+    return tile.source ? tile.source->image(size, keep) : QImage();
+}
+
+QSharedPointer<ImageGridSource> ImageGridModel::sourceAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return {};
+    }
+
+    return rows_.at(row).tiles.at(column).source;
+}
+
+qint64 ImageGridModel::keyAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return 0;
+    }
+
+    const Tile &tile = rows_.at(row).tiles.at(column);
+    return tile.source ? tile.source->key() : 0;
+}
+
+quint64 ImageGridModel::idAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return 0;
+    }
+
+    return rows_.at(row).tiles.at(column).id;
+}
+
+QSize ImageGridModel::sizeAt(const int row, const int column) const
+{
+    if(!isValid(row, column)) {
+        return {};
+    }
+
+    const Tile &tile = rows_.at(row).tiles.at(column);
+    return tile.source ? tile.source->size() : QSize();
+}
+
+const QIcon &ImageGridModel::first() const
+{
+    Q_ASSERT(!isEmpty());
+
+    return rows_.first().tiles.first().icon;
+}
+
+void ImageGridModel::insertRow(const int row, const QIcon &icon)
+{
+    insertRow(row, createTile(icon));
+}
+
+void ImageGridModel::insertRow(const int row, const QImage &image)
+{
+    insertRow(row, createTile(image));
+}
+
+void ImageGridModel::insertRow(const int row, const QSharedPointer<ImageGridSource> &source,
+                               const QIcon &icon, const quint64 id)
+{
+    insertRow(row, createTile(source, icon, id));
+}
+
+void ImageGridModel::insertRow(const int row, const Tile &tile)
+{
+    if(row < 0 || row > rows_.size()) {
+        qWarning("ImageGridModel::insertRow: Invalid row: %d", row);
+        return;
+    }
+
+    rows_.insert(row, Row{QVector<Tile>{tile}, true});
+    ++dirtyCount_;
+    ++tileCount_;
+}
+
+void ImageGridModel::insert(const int row, const int column, const QIcon &icon)
+{
+    insert(row, column, createTile(icon));
+}
+
+void ImageGridModel::insert(const int row, const int column, const QImage &image)
+{
+    insert(row, column, createTile(image));
+}
+
+void ImageGridModel::insert(const int row, const int column,
+                            const QSharedPointer<ImageGridSource> &source,
+                            const QIcon &icon, const quint64 id)
+{
+    insert(row, column, createTile(source, icon, id));
+}
+
+void ImageGridModel::insert(const int row, const int column, const Tile &tile)
+{
+    if(row < 0 || row >= rows_.size()) {
+        qWarning("ImageGridModel::insert: Invalid row: %d", row);
+        return;
+    }
+
+    QVector<Tile> &columns = rows_[row].tiles;
+    if(column < 0 || column > columns.size()) {
+        qWarning("ImageGridModel::insert: Invalid column: %d", column);
+        return;
+    }
+
+    columns.insert(column, tile);
+    markDirty(row);
+    ++tileCount_;
+}
+
+void ImageGridModel::removeRow(const int row)
+{
+    if(row < 0 || row >= rows_.size()) {
+        qWarning("ImageGridModel::removeRow: Invalid row: %d", row);
+        return;
+    }
+
+    const Row &removed = rows_.at(row);
+    tileCount_ -= removed.tiles.size();
+    if(removed.dirty) {
+        --dirtyCount_;
+    }
+
+    rows_.remove(row);
+}
+
+void ImageGridModel::remove(const int row, const int column)
+{
+    if(!isValid(row, column)) {
+        qWarning("ImageGridModel::remove: Invalid index: %dx%d", row, column);
+        return;
+    }
+
+    QVector<Tile> &columns = rows_[row].tiles;
+    if(columns.size() == 1) {
+        removeRow(row);
+        return;
+    }
+
+    columns.remove(column);
+    markDirty(row);
+    --tileCount_;
+}
+
+int ImageGridModel::removeTiles(const QSet<quint64> &ids)
+{
+    if(ids.isEmpty()) {
+        return 0;
+    }
+
+    // Compact the rows in place, kept rows move up over removed ones
+    auto removed = 0;
+    auto kept = 0;
+    for(auto row = 0; row < rows_.size(); ++row) {
+        QVector<Tile> &tiles = rows_[row].tiles;
+        const auto end = std::remove_if(tiles.begin(), tiles.end(), [&ids](const Tile &tile) {
+            return ids.contains(tile.id);
+        });
+        const auto count = static_cast<int>(tiles.end() - end);
+        tiles.erase(end, tiles.end());
+        removed += count;
+
+        Row &r = rows_[row];
+        if(r.tiles.isEmpty()) {
+            if(r.dirty) {
+                --dirtyCount_;
+            }
+
+            continue;
+        }
+
+        if(count > 0 && !r.dirty) {
+            r.dirty = true;
+            ++dirtyCount_;
+        }
+
+        if(kept != row) {
+            rows_[kept] = r;
+        }
+
+        ++kept;
+    }
+
+    rows_.resize(kept);
+    tileCount_ -= removed;
+    return removed;
+}
+
+bool ImageGridModel::move(const int row, const int column, const int toRow,
+                          const int toColumn, const bool newRow)
+{
+    if(!isValid(row, column)) {
+        qWarning("ImageGridModel::move: Invalid index: %dx%d", row, column);
+        return false;
+    }
+
+    // Validate the destination against the grid without the icon
+    const auto removesRow = columnCount(row) == 1;
+    const auto rows = rows_.size() - (removesRow ? 1 : 0);
+    if(newRow) {
+        if(toRow < 0 || toRow > rows) {
+            qWarning("ImageGridModel::move: Invalid row: %d", toRow);
+            return false;
+        }
+    }
+    else {
+        if(toRow < 0 || toRow >= rows) {
+            qWarning("ImageGridModel::move: Invalid row: %d", toRow);
+            return false;
+        }
+
+        const auto before = removesRow && toRow >= row ? toRow + 1 : toRow;
+        const auto columns = columnCount(before) - (before == row ? 1 : 0);
+        if(toColumn < 0 || toColumn > columns) {
+            qWarning("ImageGridModel::move: Invalid column: %d", toColumn);
+            return false;
+        }
+    }
+
+    const Tile tile = rows_.at(row).tiles.at(column);
+    remove(row, column);
+    if(newRow) {
+        insertRow(toRow, tile);
+    }
+    else {
+        insert(toRow, toColumn, tile);
+    }
+
+    return true;
+}
+
+bool ImageGridModel::moveRow(const int row, const int toRow)
+{
+    if(row < 0 || row >= rows_.size()) {
+        qWarning("ImageGridModel::moveRow: Invalid row: %d", row);
+        return false;
+    }
+
+    if(toRow < 0 || toRow >= rows_.size()) {
+        qWarning("ImageGridModel::moveRow: Invalid row: %d", toRow);
+        return false;
+    }
+
+    // Only the row handle moves, the icons are shared
+    const Row moved = rows_.at(row);
+    rows_.remove(row);
+    rows_.insert(toRow, moved);
+    if(!moved.dirty) {
+        rows_[toRow].dirty = true;
+        ++dirtyCount_;
+    }
+
+    return true;
+}
+
+void ImageGridModel::clear()
+{
+    rows_.clear();
+    dirtyCount_ = 0;
+    tileCount_ = 0;
+}
+
+void ImageGridModel::rearrange(const QVector<int> &columns)
+{
+    auto total = 0;
+    for(const auto count : columns) {
+        if(count <= 0) {
+            qWarning("ImageGridModel::rearrange: Invalid column count: %d", count);
+            return;
+        }
+
+        total += count;
+    }
+
+    if(total != tileCount_) {
+        qWarning("ImageGridModel::rearrange: Column counts add up to %d, not %d",
+                 total, tileCount_);
+        return;
+    }
+
+    QVector<Row> rows;
+    rows.reserve(columns.size());
+    auto source = rows_.begin();
+    auto column = 0;
+    for(const auto count : columns) {
+        QVector<Tile> tiles;
+        tiles.reserve(count);
+        while(tiles.size() < count) {
+            const auto take = qMin(count - tiles.size(), source->tiles.size() - column);
+            tiles += source->tiles.mid(column, take);
+            column += take;
+            if(column == source->tiles.size()) {
+                ++source;
+                column = 0;
+            }
+        }
+
+        rows.append(Row{tiles, true});
+    }
+
+    rows_.swap(rows);
+    dirtyCount_ = rows_.size();
+}
+
+bool ImageGridModel::isDirty(const int row) const
+{
+    if(row < 0 || row >= rows_.size()) {
+        return false;
+    }
+
+    return rows_.at(row).dirty;
+}
+
+bool ImageGridModel::hasDirtyRows() const
+{
+    return dirtyCount_ > 0;
+}
+
+void ImageGridModel::markDirty(const int row)
+{
+    if(row < 0 || row >= rows_.size()) {
+        qWarning("ImageGridModel::markDirty: Invalid row: %d", row);
+        return;
+    }
+
+    Row &r = rows_[row];
+    if(!r.dirty) {
+        r.dirty = true;
+        ++dirtyCount_;
+    }
+}
+
+void ImageGridModel::markAllDirty()
+{
+    for(Row &row : rows_) {
+        row.dirty = true;
+    }
+
+    dirtyCount_ = rows_.size();
+}
+
+void ImageGridModel::clearDirty()
+{
+    if(dirtyCount_ == 0) {
+        return;
+    }
+
+    for(Row &row : rows_) {
+        row.dirty = false;
+    }
+
+    dirtyCount_ = 0;
+}
@@ -0,0 +1,389 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDMODEL_HPP
+#define IMAGEGRIDMODEL_HPP
+
+#include <QIcon>
+#include <QImage>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSize>
+#include <QVector>
+#include "imagegridsource.hpp"
+
+/**
+ * @brief Row-indexed storage for the icons of an image grid
+ *
+ * Each row is a contiguous array of icons so that row and column
+ * counts are O(1) and inserting or removing a tile only touches the
+ * row it belongs to. Inserting or removing a whole row only moves
+ * the row handles, not the icons themselves.
+ *
+ * Rows whose icons change are marked dirty so that only those rows
+ * need to be laid out and rescaled again.
+ *
+ * Every tile has an ImageGridSource that its scaled images are made
+ * from outside the GUI thread, and an id that stays the same while it
+ * moves around the grid. Tiles inserted from files or devices have a
+ * null icon and decode only as much of the image as they are shown at.
+ */
+class ImageGridModel
+{
+    //! An icon in the grid
+    struct Tile {
+        //! Icon as inserted
+        QIcon icon;
+
+        //! Image the tile is scaled from
+        QSharedPointer<ImageGridSource> source;
+
+        //! Unique id of the tile
+        quint64 id;
+    };
+
+    //! A row of icons
+    struct Row {
+        //! Icons on the row
+        QVector<Tile> tiles;
+
+        //! If the row changed since the last clearDirty()
+        bool dirty;
+    };
+
+    //! Rows of icons
+    QVector<Row> rows_;
+
+    //! Number of dirty rows
+    int dirtyCount_;
+
+    //! Total number of icons in all rows
+    int tileCount_;
+
+    //! Id for the next inserted icon
+    quint64 nextId_;
+
+    /**
+     * @brief Create a tile for an icon
+     * @param icon Icon
+     * @return New tile with a unique id
+     */
+    Tile createTile(const QIcon &icon);
+
+    /**
+     * @brief Create a tile for an image with no icon
+     * @param image Image
+     * @return New tile with a unique id
+     */
+    Tile createTile(const QImage &image);
+
+    /**
+     * @brief Create a tile for an image source
+     * @param source Image source
+     * @param icon Icon the source was made from, may be null
+     * @param id Id of a removed tile to reuse, 0 for a new one
+     * @return New tile
+     */
+    Tile createTile(const QSharedPointer<ImageGridSource> &source, const QIcon &icon,
+                    quint64 id);
+
+    /**
+     * @brief Insert a tile as a new row before row
+     * @param row Row to insert before, may be equal to rowCount()
+     * @param tile Tile to add
+     */
+    void insertRow(int row, const Tile &tile);
+
+    /**
+     * @brief Insert a tile into an existing row before column
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to columnCount()
+     * @param tile Tile to add
+     */
+    void insert(int row, int column, const Tile &tile);
+
+public:
+    /**
+     * @brief Constructor
+     */
+    ImageGridModel();
+
+    /**
+     * @brief Get number of rows
+     * @return Number of rows
+     */
+    int rowCount() const;
+
+    /**
+     * @brief Get number of columns for a row
+     * @param row Row to get columns for
+     * @return Number of columns or 0 if row is invalid
+     */
+    int columnCount(int row) const;
+
+    /**
+     * @brief Get number of icons in all rows
+     * @return Number of icons
+     */
+    int tileCount() const;
+
+    /**
+     * @brief Check if the model has no icons
+     * @return True if empty
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Check if index points to an existing icon
+     * @param row Row
+     * @param column Column
+     * @return True if valid
+     */
+    bool isValid(int row, int column) const;
+
+    /**
+     * @brief Get icon at index
+     * @param row Row
+     * @param column Column
+     * @return Icon or null icon if index is invalid
+     */
+    QIcon iconAt(int row, int column) const;
+
+    /**
+     * @brief Get the largest image decoded so far at index
+     * @param row Row
+     * @param column Column
+     * @return Image or null image if index is invalid
+     */
+    QImage imageAt(int row, int column) const;
+
+    /**
+     * @brief Get an image at index at least as large as size
+     *
+     * Decodes the image again if needed
+     * @param row Row
+     * @param column Column
+     * @param size Size the image will be scaled to
+     * @param keep If a newly decoded image is kept for later calls
+     * @return Image or null image if index is invalid
+     */
+    QImage imageAt(int row, int column, const QSize &size, bool keep = true) const;
+
+    /**
+     * @brief Get image source at index
+     * @param row Row
+     * @param column Column
+     * @return Source or null if index is invalid
+     */
+    QSharedPointer<ImageGridSource> sourceAt(int row, int column) const;
+
+    /**
+     * @brief Get the key that identifies the image at index in pixmap caches
+     * @param row Row
+     * @param column Column
+     * @return Key or 0 if index is invalid
+     */
+    qint64 keyAt(int row, int column) const;
+
+    /**
+     * @brief Get id of the icon at index
+     * @param row Row
+     * @param column Column
+     * @return Id or 0 if index is invalid
+     */
+    quint64 idAt(int row, int column) const;
+
+    /**
+     * @brief Get full resolution size of the image at index
+     * @param row Row
+     * @param column Column
+     * @return Size or null size if index is invalid
+     */
+    QSize sizeAt(int row, int column) const;
+
+    /**
+     * @brief Get the first icon in the grid
+     *
+     * The model must not be empty
+     * @return First icon
+     */
+    const QIcon &first() const;
+
+    /**
+     * @brief Insert icon as a new row before row
+     * @param row Row to insert before, may be equal to rowCount()
+     * @param icon Icon to add
+     */
+    void insertRow(int row, const QIcon &icon);
+
+    /**
+     * @brief Insert image as a new row before row
+     *
+     * The tile has a null icon
+     * @param row Row to insert before, may be equal to rowCount()
+     * @param image Image to add
+     */
+    void insertRow(int row, const QImage &image);
+
+    /**
+     * @brief Insert image source as a new row before row
+     *
+     * Sharing the source and id of a removed tile brings the tile back
+     * without decoding or converting its image again, and without
+     * invalidating anything that refers to the tile by id
+     * @param row Row to insert before, may be equal to rowCount()
+     * @param source Image source to add
+     * @param icon Icon the source was made from, may be null
+     * @param id Id of a removed tile to reuse, 0 for a new one
+     */
+    void insertRow(int row, const QSharedPointer<ImageGridSource> &source,
+                   const QIcon &icon = QIcon(), quint64 id = 0);
+
+    /**
+     * @brief Insert icon into an existing row before column
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to columnCount()
+     * @param icon Icon to add
+     */
+    void insert(int row, int column, const QIcon &icon);
+
+    /**
+     * @brief Insert image into an existing row before column
+     *
+     * The tile has a null icon
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to columnCount()
+     * @param image Image to add
+     */
+    void insert(int row, int column, const QImage &image);
+
+    /**
+     * @brief Insert image source into an existing row before column
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to columnCount()
+     * @param source Image source to add
+     * @param icon Icon the source was made from, may be null
+     * @param id Id of a removed tile to reuse, 0 for a new one
+     */
+    void insert(int row, int column, const QSharedPointer<ImageGridSource> &source,
+                const QIcon &icon = QIcon(), quint64 id = 0);
+
+    /**
+     * @brief Remove row and all of its icons
+     * @param row Row to remove
+     */
+    void removeRow(int row);
+
+    /**
+     * @brief Remove icon at index
+     *
+     * Removes the whole row if it was the last icon on the row
+     * @param row Row
+     * @param column Column
+     */
+    void remove(int row, int column);
+
+    /**
+     * @brief Remove every icon whose id is in ids
+     *
+     * Runs in a single pass over the grid however many icons are removed.
+     * Rows left without icons are removed, other rows that lost icons
+     * are marked dirty
+     * @param ids Ids of the icons to remove
+     * @return Number of icons removed
+     */
+    int removeTiles(const QSet<quint64> &ids);
+
+    /**
+     * @brief Move an icon to another position, keeping its id
+     *
+     * The destination is given as if the icon had already been removed,
+     * so a tile moved back to where it was taken from restores the grid.
+     * The source and destination rows are marked dirty
+     * @param row Row of the icon
+     * @param column Column of the icon
+     * @param toRow Row to move into, or before if newRow is true
+     * @param toColumn Column to move before, ignored if newRow is true
+     * @param newRow If the icon becomes a row of its own
+     * @return True if moved
+     */
+    bool move(int row, int column, int toRow, int toColumn, bool newRow);
+
+    /**
+     * @brief Move a row and all of its icons before another row
+     *
+     * The destination is given as if the row had already been removed.
+     * The moved row is marked dirty
+     * @param row Row to move
+     * @param toRow Row to move before, may be equal to rowCount() - 1
+     * @return True if moved
+     */
+    bool moveRow(int row, int toRow);
+
+    /**
+     * @brief Remove all icons
+     */
+    void clear();
+
+    /**
+     * @brief Split the icons into new rows, keeping their order
+     *
+     * Every row is marked dirty
+     * @param columns Number of icons on each new row, must add up to tileCount()
+     */
+    void rearrange(const QVector<int> &columns);
+
+    /**
+     * @brief Check if a row changed since the last clearDirty()
+     *
+     * Inserting into and removing from a row marks it dirty
+     * @param row Row
+     * @return True if dirty
+     */
+    bool isDirty(int row) const;
+
+    /**
+     * @brief Check if any row changed since the last clearDirty()
+     * @return True if any row is dirty
+     */
+    bool hasDirtyRows() const;
+
+    /**
+     * @brief Mark a row dirty
+     * @param row Row
+     */
+    void markDirty(int row);
+
+    /**
+     * @brief Mark every row dirty
+     */
+    void markAllDirty();
+
+    /**
+     * @brief Mark every row clean
+     */
+    void clearDirty();
+};
+
+#endif // IMAGEGRIDMODEL_HPP
@@ -0,0 +1,117 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <climits>
+#include <QtGlobal>
+#include "imagegridpixmapcache.hpp"
+
+namespace {
+
+int toCost(const qint64 bytes) {
+    return static_cast<int>(qBound<qint64>(0, bytes / 1024, INT_MAX));
+}
+
+int pixmapCost(const QPixmap &pixmap) {
+    const auto bytes = static_cast<qint64>(pixmap.width()) * pixmap.height()
+            * pixmap.depth() / 8;
+    return qMax(1, toCost(bytes));
+}
+
+} // namespace
+
+ImageGridPixmapCache::ImageGridPixmapCache(const qint64 maxBytes) :
+    cache_(toCost(maxBytes)),
+    hits_(0),
+    misses_(0)
+{
+
+}
+
+bool ImageGridPixmapCache::find(const Key &key, QPixmap *pixmap)
+{
+    const QPixmap *cached = cache_.object(key);
+    if(!cached) {
+        ++misses_;
+        return false;
+    }
+
+    ++hits_;
+    *pixmap = *cached;
+    return true;
+}
+
+void ImageGridPixmapCache::insert(const Key &key, const QPixmap &pixmap)
+{
+    if(pixmap.isNull()) {
+        return;
+    }
+
+    cache_.insert(key, new QPixmap(pixmap), pixmapCost(pixmap));
+}
+
+void ImageGridPixmapCache::clear()
+{
+    cache_.clear();
+}
+
+void ImageGridPixmapCache::setMaxBytes(const qint64 maxBytes)
+{
+    if(maxBytes < 0) {
+        qWarning("ImageGridPixmapCache::setMaxBytes: Negative size: %lld", maxBytes);
+        return;
+    }
+
+    cache_.setMaxCost(toCost(maxBytes));
+}
+
+qint64 ImageGridPixmapCache::maxBytes() const
+{
+    return static_cast<qint64>(cache_.maxCost()) * 1024;
+}
+
+qint64 ImageGridPixmapCache::bytes() const
+{
+    return static_cast<qint64>(cache_.totalCost()) * 1024;
+}
+
+int ImageGridPixmapCache::count() const
+{
+    return cache_.count();
+}
+
+quint64 ImageGridPixmapCache::hits() const
+{
+    return hits_;
+}
+
+quint64 ImageGridPixmapCache::misses() const
+{
+    return misses_;
+}
+
+void ImageGridPixmapCache::resetStats()
+{
+    hits_ = 0;
+    misses_ = 0;
+}
@@ -0,0 +1,152 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDPIXMAPCACHE_HPP
+#define IMAGEGRIDPIXMAPCACHE_HPP
+
+#include <QCache>
+#include <QHash>
+#include <QPixmap>
+#include <QSize>
+
+/**
+ * @brief Bounded LRU cache of scaled tile pixmaps
+ *
+ * Pixmaps are keyed by the cache key of the image source, the size they
+ * were scaled to and the scaling method used. The least recently
+ * used pixmaps are evicted once the byte budget is exceeded.
+ */
+class ImageGridPixmapCache
+{
+public:
+    //! Identifies a scaled pixmap
+    struct Key {
+        //! Cache key of the image source, see ImageGridSource::key()
+        qint64 source;
+
+        //! Size the source was scaled to
+        QSize size;
+
+        //! How the image was scaled, see ImageGridScaler::method()
+        int mode;
+
+        friend bool operator==(const Key &lhs, const Key &rhs) {
+            return lhs.source == rhs.source && lhs.size == rhs.size
+                    && lhs.mode == rhs.mode;
+        }
+
+        friend uint qHash(const Key &key, const uint seed = 0) {
+            return qHash(key.source, seed)
+                    ^ (static_cast<uint>(key.size.width()) << 16)
+                    ^ static_cast<uint>(key.size.height())
+                    ^ (static_cast<uint>(key.mode) << 30);
+        }
+    };
+
+private:
+    //! Cached pixmaps, costs are in KiB
+    QCache<Key, QPixmap> cache_;
+
+    //! Number of successful lookups
+    quint64 hits_;
+
+    //! Number of failed lookups
+    quint64 misses_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param maxBytes Byte budget of the cache
+     */
+    explicit ImageGridPixmapCache(qint64 maxBytes = 128 * 1024 * 1024);
+
+    /**
+     * @brief Look up a scaled pixmap
+     *
+     * Marks the pixmap as most recently used on a hit
+     * @param key Key to look up
+     * @param pixmap Receives the pixmap on a hit
+     * @return True on a hit
+     */
+    bool find(const Key &key, QPixmap *pixmap);
+
+    /**
+     * @brief Insert a scaled pixmap
+     *
+     * Pixmaps larger than the whole budget are not cached
+     * @param key Key of the pixmap
+     * @param pixmap Scaled pixmap
+     */
+    void insert(const Key &key, const QPixmap &pixmap);
+
+    /**
+     * @brief Remove all pixmaps
+     */
+    void clear();
+
+    /**
+     * @brief Set byte budget
+     *
+     * Evicts pixmaps immediately if the cache is over the new budget
+     * @param maxBytes Byte budget
+     */
+    void setMaxBytes(qint64 maxBytes);
+
+    /**
+     * @brief Get byte budget
+     * @return Byte budget
+     */
+    qint64 maxBytes() const;
+
+    /**
+     * @brief Get approximate number of bytes held
+     * @return Bytes held
+     */
+    qint64 bytes() const;
+
+    /**
+     * @brief Get number of cached pixmaps
+     * @return Number of pixmaps
+     */
+    int count() const;
+
+    /**
+     * @brief Get number of successful lookups
+     * @return Number of hits
+     */
+    quint64 hits() const;
+
+    /**
+     * @brief Get number of failed lookups
+     * @return Number of misses
+     */
+    quint64 misses() const;
+
+    /**
+     * @brief Reset hit and miss counters
+     */
+    void resetStats();
+};
+
+#endif // IMAGEGRIDPIXMAPCACHE_HPP
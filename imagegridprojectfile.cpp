@@ -0,0 +1,319 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QImage>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QSize>
+#include <QSysInfo>
+#include "imagegridprojectfile.hpp"
+#include "imagegridresampler.hpp"
+
+namespace {
+
+//! Thumbnails start at a multiple of this many bytes from the start of the file
+const qint64 Alignment = 16;
+
+//! Index entry of a tile
+struct Entry {
+    //! File the source decodes from, empty if it has encoded data
+    QString path;
+
+    //! Encoded image of sources not read from a file
+    QByteArray data;
+
+    //! Size of the full resolution image
+    QSize size;
+
+    //! Size of the thumbnail
+    QSize thumbnailSize;
+
+    //! Offset of the thumbnail from the start of the thumbnail block
+    quint64 offset;
+};
+
+QDataStream &operator<<(QDataStream &stream, const Entry &entry)
+{
+    return stream << entry.path << entry.data << entry.size
+                  << entry.thumbnailSize << entry.offset;
+}
+
+QDataStream &operator>>(QDataStream &stream, Entry &entry)
+{
+    return stream >> entry.path >> entry.data >> entry.size
+                  >> entry.thumbnailSize >> entry.offset;
+}
+
+/**
+ * @brief Round a file position up to the thumbnail alignment
+ * @param pos File position
+ * @return Aligned position
+ */
+qint64 aligned(const qint64 pos)
+{
+    return (pos + Alignment - 1) / Alignment * Alignment;
+}
+
+/**
+ * @brief Get the number of bytes a thumbnail takes in the file
+ * @param size Thumbnail size
+ * @return Bytes
+ */
+quint64 thumbnailBytes(const QSize &size)
+{
+    return size.isEmpty() ? 0 : static_cast<quint64>(size.width()) * size.height() * 4;
+}
+
+/**
+ * @brief Get encoded data for a source that isn't read from a file
+ *
+ * Sources read from a device keep their data, images and icons are
+ * encoded as PNG
+ * @param source Source
+ * @return Encoded image, empty if the source has no pixels
+ */
+QByteArray encode(const ImageGridSource &source)
+{
+    QByteArray data = source.data();
+    if(!data.isEmpty()) {
+        return data;
+    }
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    source.image().save(&buffer, "PNG");
+    return data;
+}
+
+/**
+ * @brief Close a mapped project file once no thumbnail points into it
+ * @param info Shared pointer to the file
+ */
+void releaseFile(void *info)
+{
+    delete static_cast<QSharedPointer<QFile> *>(info);
+}
+
+} // namespace
+
+ImageGridProjectFile::ImageGridProjectFile(const QString &fileName) :
+    fileName_(fileName),
+    errorString_()
+{
+
+}
+
+bool ImageGridProjectFile::write(const ImageGridModel &grid, const ImageGridLayout &layout,
+                                 const Settings &settings,
+                                 const QHash<quint64, QPixmap> &pixmaps)
+{
+    QSaveFile file(fileName_);
+    if(!file.open(QIODevice::WriteOnly)) {
+        errorString_ = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << Magic << Version << static_cast<quint8>(QSysInfo::ByteOrder)
+           << static_cast<qint32>(settings.spacing) << static_cast<qint32>(settings.width)
+           << settings.pen << settings.backgroundColor
+           << static_cast<qint32>(settings.layoutMode)
+           << static_cast<qint32>(settings.targetRowHeight);
+
+    // Thumbnail sizes are known up front so the index can hold every offset
+    const auto rows = grid.rowCount();
+    QVector<QVector<QSize>> sizes;
+    sizes.reserve(rows);
+    quint64 offset = 0;
+    stream << static_cast<quint32>(rows);
+    for(auto row = 0; row < rows; ++row) {
+        const QVector<QSize> rowSizes = layout.rowSizes(grid, row);
+        const auto cols = grid.columnCount(row);
+        stream << static_cast<quint32>(cols);
+        sizes.append(QVector<QSize>());
+        for(auto col = 0; col < cols; ++col) {
+            const QSharedPointer<ImageGridSource> source = grid.sourceAt(row, col);
+            Entry entry{source->path(), QByteArray(), source->size(),
+                        rowSizes.value(col).boundedTo(source->size()), offset};
+            if(entry.path.isEmpty()) {
+                entry.data = encode(*source);
+            }
+
+            stream << entry;
+            offset += thumbnailBytes(entry.thumbnailSize);
+            sizes.last().append(entry.thumbnailSize);
+        }
+    }
+
+    // Thumbnails start aligned so they can be used in place once mapped
+    const QByteArray padding(aligned(file.pos()) - file.pos(), '\0');
+    stream.writeRawData(padding.constData(), padding.size());
+
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            const QSize &size = sizes.at(row).at(col);
+            if(size.isEmpty()) {
+                continue;
+            }
+
+            // Pixmaps already on screen are used as they are
+            const QPixmap pixmap = pixmaps.value(grid.idAt(row, col));
+            QImage thumbnail = pixmap.size() == size ? pixmap.toImage() :
+                    ImageGridResampler::scaled(grid.imageAt(row, col, size, false), size);
+            if(thumbnail.size() != size) {
+                thumbnail = QImage(size, QImage::Format_ARGB32_Premultiplied);
+                thumbnail.fill(Qt::transparent);
+            }
+            else if(thumbnail.format() != QImage::Format_ARGB32_Premultiplied) {
+                thumbnail = thumbnail.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            }
+
+            for(auto y = 0; y < size.height(); ++y) {
+                stream.writeRawData(reinterpret_cast<const char *>(thumbnail.constScanLine(y)),
+                                    size.width() * 4);
+            }
+        }
+    }
+
+    if(stream.status() != QDataStream::Ok) {
+        errorString_ = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+
+    if(!file.commit()) {
+        errorString_ = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageGridProjectFile::read(Settings *settings, Rows *rows)
+{
+    QSharedPointer<QFile> file(new QFile(fileName_));
+    if(!file->open(QIODevice::ReadOnly)) {
+        errorString_ = file->errorString();
+        return false;
+    }
+
+    QDataStream stream(file.data());
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint8 byteOrder = 0;
+    stream >> magic >> version >> byteOrder;
+    if(magic != Magic) {
+        errorString_ = QStringLiteral("Not an image grid project: %1").arg(fileName_);
+        return false;
+    }
+
+    if(version == 0 || version > Version) {
+        errorString_ = QStringLiteral("Unsupported project version: %1").arg(version);
+        return false;
+    }
+
+    qint32 spacing = 0;
+    qint32 width = 0;
+    QPen pen;
+    QColor backgroundColor;
+    qint32 layoutMode = 0;
+    qint32 targetRowHeight = 0;
+    stream >> spacing >> width >> pen >> backgroundColor >> layoutMode >> targetRowHeight;
+
+    // Counts are not trusted for allocations, a corrupt file fails the stream instead
+    QVector<QVector<Entry>> entries;
+    quint32 rowCount = 0;
+    stream >> rowCount;
+    for(quint32 row = 0; row < rowCount && stream.status() == QDataStream::Ok; ++row) {
+        quint32 cols = 0;
+        stream >> cols;
+        entries.append(QVector<Entry>());
+        for(quint32 col = 0; col < cols && stream.status() == QDataStream::Ok; ++col) {
+            Entry entry;
+            stream >> entry;
+            entries.last().append(entry);
+        }
+    }
+
+    if(stream.status() != QDataStream::Ok) {
+        errorString_ = QStringLiteral("Corrupt project: %1").arg(fileName_);
+        return false;
+    }
+
+    // Thumbnails written with another byte order would need converting,
+    // their sources are decoded instead
+    const qint64 base = aligned(file->pos());
+    const qint64 length = file->size() - base;
+    const uchar *pixels = 0;
+    if(byteOrder == QSysInfo::ByteOrder && length > 0) {
+        pixels = file->map(base, length);
+    }
+
+    rows->clear();
+    for(const QVector<Entry> &row : entries) {
+        QVector<QSharedPointer<ImageGridSource>> sources;
+        for(const Entry &entry : row) {
+            QImage thumbnail;
+            const QSize &size = entry.thumbnailSize;
+            const auto bytes = thumbnailBytes(size);
+            if(pixels && bytes > 0 && entry.offset + bytes <= static_cast<quint64>(length)) {
+                thumbnail = QImage(pixels + entry.offset, size.width(), size.height(),
+                                   size.width() * 4, QImage::Format_ARGB32_Premultiplied,
+                                   releaseFile, new QSharedPointer<QFile>(file));
+            }
+
+            const QSharedPointer<ImageGridSource> source = entry.path.isEmpty() ?
+                        ImageGridSource::fromData(entry.data, entry.size, thumbnail) :
+                        ImageGridSource::fromFile(entry.path, entry.size, thumbnail);
+            if(source) {
+                sources.append(source);
+            }
+        }
+
+        if(!sources.isEmpty()) {
+            rows->append(sources);
+        }
+    }
+
+    settings->spacing = spacing;
+    settings->width = width;
+    settings->pen = pen;
+    settings->backgroundColor = backgroundColor;
+    settings->layoutMode = layoutMode == ImageGridLayout::JustifiedRows ?
+                ImageGridLayout::JustifiedRows : ImageGridLayout::UniformRows;
+    settings->targetRowHeight = targetRowHeight;
+    return true;
+}
+
+QString ImageGridProjectFile::errorString() const
+{
+    return errorString_;
+}
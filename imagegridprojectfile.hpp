@@ -0,0 +1,129 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDPROJECTFILE_HPP
+#define IMAGEGRIDPROJECTFILE_HPP
+
+#include <QColor>
+#include <QHash>
+#include <QPen>
+#include <QPixmap>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "imagegridlayout.hpp"
+#include "imagegridmodel.hpp"
+#include "imagegridsource.hpp"
+
+/**
+ * @brief Saves and loads a grid with its settings and tile thumbnails
+ *
+ * The file starts with a versioned QDataStream index holding the
+ * settings, the row structure and a reference to every source: the
+ * path of files, the encoded data of everything else. The index is
+ * followed by one uncompressed ARGB32 premultiplied thumbnail per tile
+ * at the size it was shown at when saved.
+ *
+ * On load the thumbnail block is memory-mapped and every source starts
+ * with its thumbnail pointing straight into the mapping, so a project
+ * shows all its tiles without decoding anything. Full resolution images
+ * are read only when a tile is shown larger than its thumbnail.
+ */
+class ImageGridProjectFile
+{
+public:
+    //! Widget settings stored with the grid
+    struct Settings {
+        //! Space between images in pixels
+        int spacing;
+
+        //! Layout width in pixels
+        int width;
+
+        //! Pen for drawing helper lines
+        QPen pen;
+
+        //! Background color
+        QColor backgroundColor;
+
+        //! How tile sizes on a row are calculated
+        ImageGridLayout::Mode layoutMode;
+
+        //! Row height tiles are arranged around, 0 keeps the rows as saved
+        int targetRowHeight;
+    };
+
+    //! Sources of each row
+    using Rows = QVector<QVector<QSharedPointer<ImageGridSource>>>;
+
+    //! First four bytes of every project file
+    static const quint32 Magic = 0x49475750;
+
+    //! Current version of the format
+    static const quint32 Version = 1;
+
+private:
+    //! Project file
+    QString fileName_;
+
+    //! Description of the last error
+    QString errorString_;
+
+public:
+    /**
+     * @brief Constructor
+     * @param fileName Project file
+     */
+    explicit ImageGridProjectFile(const QString &fileName);
+
+    /**
+     * @brief Write a grid to the file
+     *
+     * Thumbnails are taken from pixmaps when one of the right size
+     * exists and scaled from the sources otherwise
+     * @param grid Grid to write
+     * @param layout Layout the thumbnail sizes are calculated with
+     * @param settings Settings to write
+     * @param pixmaps Finished pixmaps by tile id
+     * @return True on success
+     */
+    bool write(const ImageGridModel &grid, const ImageGridLayout &layout,
+               const Settings &settings, const QHash<quint64, QPixmap> &pixmaps);
+
+    /**
+     * @brief Read a grid from the file
+     * @param settings Settings read from the file
+     * @param rows Sources of each row
+     * @return True on success
+     */
+    bool read(Settings *settings, Rows *rows);
+
+    /**
+     * @brief Get description of the last error
+     * @return Error string
+     */
+    QString errorString() const;
+};
+
+#endif // IMAGEGRIDPROJECTFILE_HPP
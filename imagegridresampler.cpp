@@ -0,0 +1,420 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <QAtomicInt>
+#include <QRgb>
+#include <QVector>
+#include <QtGlobal>
+#include <QtMath>
+#include "imagegridresampler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEGRID_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled for every x86 build and only run where the
+// CPU has AVX2, which needs per-function target attributes with GCC/Clang
+#if defined(IMAGEGRID_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define IMAGEGRID_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define IMAGEGRID_TARGET_AVX2
+#else
+#define IMAGEGRID_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+//! Weights of the source pixels that make up each output pixel
+struct Contributions {
+    //! Number of weights per output pixel
+    int window;
+
+    //! First source pixel of each output pixel
+    QVector<int> first;
+
+    //! window weights for each output pixel, padded with zeros
+    QVector<float> weights;
+};
+
+//! Kernels for one instruction set
+struct Kernels {
+    //! Resample a row of pixels into a row of floats
+    void (*horizontal)(const uchar *source, float *destination,
+                       const Contributions &contributions, int width);
+
+    //! Blend rows of floats into a row of pixels
+    void (*vertical)(const float *const *rows, const float *weights, int window,
+                     uchar *destination, int count);
+};
+
+double lanczos(const double x)
+{
+    if(x == 0) {
+        return 1;
+    }
+
+    if(x <= -3 || x >= 3) {
+        return 0;
+    }
+
+    const auto pix = M_PI * x;
+    return 3 * std::sin(pix) * std::sin(pix / 3) / (pix * pix);
+}
+
+Contributions contributions(const int from, const int to,
+                            const ImageGridResampler::Filter filter)
+{
+    const auto scale = static_cast<double>(from) / to;
+    const auto lanczosScale = qMax(scale, 1.0);
+    const auto support = filter == ImageGridResampler::BoxFilter ?
+                scale / 2 : 3 * lanczosScale;
+
+    Contributions result;
+    result.window = qMin(from, static_cast<int>(std::ceil(support * 2)) + 2);
+    result.first = QVector<int>(to);
+    result.weights = QVector<float>(to * result.window, 0);
+    QVector<double> weights(result.window);
+    for(auto i = 0; i < to; ++i) {
+        const auto center = (i + 0.5) * scale;
+        const auto low = static_cast<int>(std::floor(center - support));
+        const auto high = static_cast<int>(std::ceil(center + support));
+        const auto first = qBound(0, low, from - result.window);
+        weights.fill(0);
+
+        // Taps outside the image repeat the edge pixel
+        auto sum = 0.0;
+        for(auto j = low; j < high; ++j) {
+            double weight;
+            if(filter == ImageGridResampler::BoxFilter) {
+                weight = qMin(center + support, j + 1.0) - qMax(center - support, 1.0 * j);
+                if(weight <= 0) {
+                    continue;
+                }
+            }
+            else {
+                weight = lanczos((j + 0.5 - center) / lanczosScale);
+            }
+
+            weights[qBound(0, j, from - 1) - first] += weight;
+            sum += weight;
+        }
+
+        result.first[i] = first;
+        for(auto k = 0; k < result.window; ++k) {
+            result.weights[i * result.window + k] = static_cast<float>(weights.at(k) / sum);
+        }
+    }
+
+    return result;
+}
+
+void horizontalScalar(const uchar *source, float *destination,
+                      const Contributions &contributions, const int width)
+{
+    const auto window = contributions.window;
+    for(auto x = 0; x < width; ++x) {
+        const uchar *pixel = source + contributions.first.at(x) * 4;
+        const float *weights = contributions.weights.constData() + x * window;
+        float sum[4] = {0, 0, 0, 0};
+        for(auto k = 0; k < window; ++k) {
+            for(auto c = 0; c < 4; ++c) {
+                sum[c] += weights[k] * pixel[k * 4 + c];
+            }
+        }
+
+        std::memcpy(destination + x * 4, sum, sizeof(sum));
+    }
+}
+
+uchar toByte(const float value)
+{
+    return static_cast<uchar>(qBound(0L, std::lrint(value), 255L));
+}
+
+void verticalScalar(const float *const *rows, const float *weights, const int window,
+                    uchar *destination, const int count)
+{
+    for(auto i = 0; i < count; ++i) {
+        auto sum = 0.0f;
+        for(auto k = 0; k < window; ++k) {
+            sum += weights[k] * rows[k][i];
+        }
+
+        destination[i] = toByte(sum);
+    }
+}
+
+#ifdef IMAGEGRID_SSE2
+__m128 loadPixelSse2(const uchar *pixel)
+{
+    int value;
+    std::memcpy(&value, pixel, sizeof(value));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128(value);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+void storePixelSse2(const __m128i values, uchar *destination)
+{
+    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(values, values), values);
+    const int value = _mm_cvtsi128_si32(bytes);
+    std::memcpy(destination, &value, sizeof(value));
+}
+
+void horizontalSse2(const uchar *source, float *destination,
+                    const Contributions &contributions, const int width)
+{
+    const auto window = contributions.window;
+    for(auto x = 0; x < width; ++x) {
+        const uchar *pixel = source + contributions.first.at(x) * 4;
+        const float *weights = contributions.weights.constData() + x * window;
+        __m128 sum = _mm_setzero_ps();
+        for(auto k = 0; k < window; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(loadPixelSse2(pixel + k * 4),
+                                             _mm_set1_ps(weights[k])));
+        }
+
+        _mm_storeu_ps(destination + x * 4, sum);
+    }
+}
+
+void verticalSse2(const float *const *rows, const float *weights, const int window,
+                  uchar *destination, const int count)
+{
+    // count is a multiple of 4, one pixel per iteration
+    for(auto i = 0; i < count; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for(auto k = 0; k < window; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i),
+                                             _mm_set1_ps(weights[k])));
+        }
+
+        storePixelSse2(_mm_cvtps_epi32(sum), destination + i);
+    }
+}
+#endif
+
+#ifdef IMAGEGRID_AVX2
+IMAGEGRID_TARGET_AVX2
+void horizontalAvx2(const uchar *source, float *destination,
+                    const Contributions &contributions, const int width)
+{
+    const auto window = contributions.window;
+    for(auto x = 0; x < width; ++x) {
+        const uchar *pixel = source + contributions.first.at(x) * 4;
+        const float *weights = contributions.weights.constData() + x * window;
+
+        // Two source pixels per iteration, one in each 128-bit lane
+        __m256 sum = _mm256_setzero_ps();
+        auto k = 0;
+        for(; k + 1 < window; k += 2) {
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixel + k * 4));
+            const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+            const __m256 weight = _mm256_insertf128_ps(
+                        _mm256_castps128_ps256(_mm_set1_ps(weights[k])),
+                        _mm_set1_ps(weights[k + 1]), 1);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(values, weight));
+        }
+
+        __m128 total = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        if(k < window) {
+            int value;
+            std::memcpy(&value, pixel + k * 4, sizeof(value));
+            const __m128 last = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(value)));
+            total = _mm_add_ps(total, _mm_mul_ps(last, _mm_set1_ps(weights[k])));
+        }
+
+        _mm_storeu_ps(destination + x * 4, total);
+    }
+}
+
+IMAGEGRID_TARGET_AVX2
+void verticalAvx2(const float *const *rows, const float *weights, const int window,
+                  uchar *destination, const int count)
+{
+    // Two pixels per iteration, count is a multiple of 4
+    auto i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for(auto k = 0; k < window; ++k) {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i),
+                                                   _mm256_set1_ps(weights[k])));
+        }
+
+        const __m256i values = _mm256_cvtps_epi32(sum);
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(values),
+                                              _mm256_extracti128_si256(values, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(destination + i),
+                         _mm_packus_epi16(words, words));
+    }
+
+    if(i < count) {
+        __m128 sum = _mm_setzero_ps();
+        for(auto k = 0; k < window; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i),
+                                             _mm_set1_ps(weights[k])));
+        }
+
+        storePixelSse2(_mm_cvtps_epi32(sum), destination + i);
+    }
+}
+#endif
+
+ImageGridResampler::InstructionSet detectInstructionSet()
+{
+#if defined(IMAGEGRID_AVX2) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return ImageGridResampler::Avx2;
+    }
+#elif defined(IMAGEGRID_AVX2) && defined(_MSC_VER)
+    // AVX2 needs both the CPU and the OS saving the YMM registers
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] >= 7) {
+        __cpuid(info, 1);
+        const auto osxsave = (info[2] & (1 << 27)) != 0;
+        const auto avx = (info[2] & (1 << 28)) != 0;
+        if(osxsave && avx && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            if(info[1] & (1 << 5)) {
+                return ImageGridResampler::Avx2;
+            }
+        }
+    }
+#endif
+
+#ifdef IMAGEGRID_SSE2
+    return ImageGridResampler::Sse2;
+#else
+    return ImageGridResampler::Scalar;
+#endif
+}
+
+//! Instruction set in use, -1 until detected
+QAtomicInt currentInstructionSet(-1);
+
+Kernels kernels(const ImageGridResampler::InstructionSet set)
+{
+    switch(set) {
+#ifdef IMAGEGRID_AVX2
+    case ImageGridResampler::Avx2:
+        return Kernels{horizontalAvx2, verticalAvx2};
+#endif
+#ifdef IMAGEGRID_SSE2
+    case ImageGridResampler::Sse2:
+        return Kernels{horizontalSse2, verticalSse2};
+#endif
+    default:
+        return Kernels{horizontalScalar, verticalScalar};
+    }
+}
+
+} // namespace
+
+QImage ImageGridResampler::scaled(const QImage &image, const QSize &size, const Filter filter)
+{
+    if(image.isNull() || size.isEmpty()) {
+        qWarning("ImageGridResampler::scaled: Null image or empty size");
+        return {};
+    }
+
+    const QImage source = image.format() == QImage::Format_ARGB32_Premultiplied ?
+                image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if(source.size() == size) {
+        return source;
+    }
+
+    const Kernels kernel = kernels(instructionSet());
+    const Contributions horizontal = contributions(source.width(), size.width(), filter);
+    const Contributions vertical = contributions(source.height(), size.height(), filter);
+
+    // Horizontal pass over every source row into a float buffer
+    const auto stride = size.width() * 4;
+    QVector<float> buffer(source.height() * stride);
+    for(auto y = 0; y < source.height(); ++y) {
+        kernel.horizontal(source.constScanLine(y), buffer.data() + y * stride,
+                     horizontal, size.width());
+    }
+
+    QImage result(size, QImage::Format_ARGB32_Premultiplied);
+    if(result.isNull()) {
+        qWarning("ImageGridResampler::scaled: Out of memory");
+        return {};
+    }
+
+    // Vertical pass from the float buffer into the result
+    QVector<const float *> rows(vertical.window);
+    for(auto y = 0; y < size.height(); ++y) {
+        for(auto k = 0; k < vertical.window; ++k) {
+            rows[k] = buffer.constData() + (vertical.first.at(y) + k) * stride;
+        }
+
+        kernel.vertical(rows.constData(), vertical.weights.constData() + y * vertical.window,
+                   vertical.window, result.scanLine(y), stride);
+    }
+
+    // Negative lobes can leave a color above its alpha, which isn't
+    // valid premultiplied data
+    if(filter == LanczosFilter) {
+        for(auto y = 0; y < size.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(result.scanLine(y));
+            for(auto x = 0; x < size.width(); ++x) {
+                const auto alpha = qAlpha(line[x]);
+                line[x] = qRgba(qMin(qRed(line[x]), alpha), qMin(qGreen(line[x]), alpha),
+                                qMin(qBlue(line[x]), alpha), alpha);
+            }
+        }
+    }
+
+    return result;
+}
+
+ImageGridResampler::InstructionSet ImageGridResampler::instructionSet()
+{
+    auto set = currentInstructionSet.load();
+    if(set < 0) {
+        set = supportedInstructionSet();
+        currentInstructionSet.store(set);
+    }
+
+    return static_cast<InstructionSet>(set);
+}
+
+ImageGridResampler::InstructionSet ImageGridResampler::supportedInstructionSet()
+{
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+void ImageGridResampler::setInstructionSet(const InstructionSet set)
+{
+    currentInstructionSet.store(qMin(set, supportedInstructionSet()));
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDRESAMPLER_HPP
+#define IMAGEGRIDRESAMPLER_HPP
+
+#include <QImage>
+#include <QSize>
+
+/**
+ * @brief Resamples images with area averaging or a Lanczos filter
+ *
+ * Images are resampled in two separable passes through a floating
+ * point buffer with SSE2 or AVX2 kernels where the CPU has them. The
+ * instruction set is chosen once at runtime, a scalar kernel is used
+ * on other CPUs and compilers.
+ *
+ * BoxFilter averages every source pixel an output pixel covers, which
+ * is what downscaling photos needs and much faster than
+ * Qt::SmoothTransformation. LanczosFilter uses a 3-lobe Lanczos
+ * window, which is slower but keeps more detail.
+ *
+ * All functions are thread-safe.
+ */
+class ImageGridResampler
+{
+public:
+    //! Resampling filter
+    enum Filter {
+        //! Area averaging
+        BoxFilter,
+
+        //! Lanczos filter with 3 lobes
+        LanczosFilter
+    };
+
+    //! Instruction set used by the kernels
+    enum InstructionSet {
+        //! Plain C++
+        Scalar,
+
+        //! SSE2
+        Sse2,
+
+        //! AVX2
+        Avx2
+    };
+
+    /**
+     * @brief Resample an image
+     *
+     * The image is converted to QImage::Format_ARGB32_Premultiplied
+     * first if it has a different format
+     * @param image Image to resample
+     * @param size Exact size of the result
+     * @param filter Resampling filter
+     * @return Image in QImage::Format_ARGB32_Premultiplied, null if
+     * image is null or size is empty
+     */
+    static QImage scaled(const QImage &image, const QSize &size, Filter filter = BoxFilter);
+
+    /**
+     * @brief Get the instruction set the kernels use
+     * @return Instruction set
+     */
+    static InstructionSet instructionSet();
+
+    /**
+     * @brief Get the best instruction set the CPU and the build support
+     * @return Instruction set
+     */
+    static InstructionSet supportedInstructionSet();
+
+    /**
+     * @brief Set the instruction set the kernels use
+     *
+     * Meant for benchmarks and comparing results. Instruction sets
+     * better than supportedInstructionSet() are ignored
+     * @param set Instruction set
+     */
+    static void setInstructionSet(InstructionSet set);
+};
+
+#endif // IMAGEGRIDRESAMPLER_HPP
@@ -0,0 +1,203 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QMetaObject>
+#include <QMetaType>
+#include <QRunnable>
+#include "imagegridscaler.hpp"
+
+namespace {
+
+class ScaleJob : public QRunnable
+{
+    ImageGridScaler *scaler_;
+    quint64 id_;
+    int generation_;
+    QSharedPointer<ImageGridSource> source_;
+    QSize size_;
+    Qt::TransformationMode mode_;
+    ImageGridResampler::Filter filter_;
+    QSharedPointer<ImageGridStats> stats_;
+
+public:
+    ScaleJob(ImageGridScaler *scaler, const quint64 id, const int generation,
+             const QSharedPointer<ImageGridSource> &source, const QSize &size,
+             const Qt::TransformationMode mode, const ImageGridResampler::Filter filter,
+             const QSharedPointer<ImageGridStats> &stats) :
+        QRunnable(),
+        scaler_(scaler),
+        id_(id),
+        generation_(generation),
+        source_(source),
+        size_(size),
+        mode_(mode),
+        filter_(filter),
+        stats_(stats)
+    {
+
+    }
+
+    void run() override {
+        // A newer layout has superseded this job
+        if(scaler_->isCancelled(generation_)) {
+            return;
+        }
+
+        ImageGridTimer timer(*stats_, ImageGridStats::ScalePhase, 1);
+
+        // Decodes the source first if it hasn't been decoded large enough
+        const QImage source = source_->image(size_);
+        const QImage image = source.isNull() ? QImage() :
+                    mode_ == Qt::SmoothTransformation ?
+                    ImageGridResampler::scaled(source, size_, filter_) :
+                    source.scaled(size_, Qt::IgnoreAspectRatio, mode_);
+        if(image.isNull()) {
+            QMetaObject::invokeMethod(scaler_, "fail", Qt::QueuedConnection,
+                                      Q_ARG(quint64, id_),
+                                      Q_ARG(int, generation_),
+                                      Q_ARG(QSize, size_));
+            return;
+        }
+
+        QMetaObject::invokeMethod(scaler_, "finish", Qt::QueuedConnection,
+                                  Q_ARG(quint64, id_),
+                                  Q_ARG(int, generation_),
+                                  Q_ARG(QImage, image));
+    }
+};
+
+} // namespace
+
+ImageGridScaler::ImageGridScaler(QObject *parent) :
+    QObject(parent),
+    pool_(),
+    generation_(0),
+    mode_(Qt::SmoothTransformation),
+    filter_(ImageGridResampler::BoxFilter),
+    stats_(new ImageGridStats)
+{
+    qRegisterMetaType<quint64>("quint64");
+}
+
+ImageGridScaler::~ImageGridScaler()
+{
+    cancel();
+    pool_.waitForDone();
+}
+
+void ImageGridScaler::scale(const quint64 id, const QImage &source, const QSize &size)
+{
+    if(source.isNull()) {
+        qWarning("ImageGridScaler::scale: Null image");
+        return;
+    }
+
+    scale(id, ImageGridSource::fromImage(source), size);
+}
+
+void ImageGridScaler::scale(const quint64 id, const QSharedPointer<ImageGridSource> &source,
+                            const QSize &size)
+{
+    if(!source || size.isEmpty()) {
+        qWarning("ImageGridScaler::scale: Null source or empty size");
+        return;
+    }
+
+    pool_.start(new ScaleJob(this, id, generation_.load(), source, size, mode_, filter_,
+                             stats_));
+}
+
+void ImageGridScaler::cancel()
+{
+    pool_.clear();
+    generation_.ref();
+}
+
+bool ImageGridScaler::isCancelled(const int generation) const
+{
+    return generation_.load() != generation;
+}
+
+void ImageGridScaler::setMaxThreadCount(const int count)
+{
+    if(count < 1) {
+        qWarning("ImageGridScaler::setMaxThreadCount: Invalid count: %d", count);
+        return;
+    }
+
+    pool_.setMaxThreadCount(count);
+}
+
+void ImageGridScaler::setTransformationMode(const Qt::TransformationMode mode)
+{
+    mode_ = mode;
+}
+
+Qt::TransformationMode ImageGridScaler::transformationMode() const
+{
+    return mode_;
+}
+
+void ImageGridScaler::setFilter(const ImageGridResampler::Filter filter)
+{
+    filter_ = filter;
+}
+
+ImageGridResampler::Filter ImageGridScaler::filter() const
+{
+    return filter_;
+}
+
+int ImageGridScaler::method() const
+{
+    return mode_ == Qt::SmoothTransformation ? Qt::SmoothTransformation + filter_ : mode_;
+}
+
+void ImageGridScaler::setStats(const QSharedPointer<ImageGridStats> &stats)
+{
+    if(!stats) {
+        qWarning("ImageGridScaler::setStats: Null stats");
+        return;
+    }
+
+    stats_ = stats;
+}
+
+void ImageGridScaler::finish(const quint64 id, const int generation, const QImage &image)
+{
+    if(isCancelled(generation)) {
+        return;
+    }
+
+    emit scaled(id, image);
+}
+
+void ImageGridScaler::fail(const quint64 id, const int generation, const QSize &size)
+{
+    if(isCancelled(generation)) {
+        return;
+    }
+
+    emit failed(id, size);
+}
@@ -0,0 +1,192 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDSCALER_HPP
+#define IMAGEGRIDSCALER_HPP
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QThreadPool>
+#include "imagegridresampler.hpp"
+#include "imagegridsource.hpp"
+#include "imagegridstats.hpp"
+
+/**
+ * @brief Scales tile images on a thread pool
+ *
+ * Results are delivered through scaled() on the thread the scaler
+ * lives in, jobs whose source can't be decoded or scaled report
+ * failed() instead. cancel() drops queued jobs and discards the results of
+ * jobs that are already running so a newer layout never receives
+ * images meant for an older one.
+ */
+class ImageGridScaler : public QObject
+{
+    Q_OBJECT
+
+    //! Threads running the scale jobs
+    QThreadPool pool_;
+
+    //! Incremented by cancel(), jobs from older generations are dropped
+    QAtomicInt generation_;
+
+    //! Transformation mode used for scaling
+    Qt::TransformationMode mode_;
+
+    //! Filter used with Qt::SmoothTransformation
+    ImageGridResampler::Filter filter_;
+
+    //! Stats the scale jobs are recorded to
+    QSharedPointer<ImageGridStats> stats_;
+
+    /**
+     * @brief Deliver a finished job
+     * @param id Id of the tile
+     * @param generation Generation the job was started in
+     * @param image Scaled image
+     */
+    Q_INVOKABLE void finish(quint64 id, int generation, const QImage &image);
+
+    /**
+     * @brief Deliver a job that produced no image
+     * @param id Id of the tile
+     * @param generation Generation the job was started in
+     * @param size Size the job was queued with
+     */
+    Q_INVOKABLE void fail(quint64 id, int generation, const QSize &size);
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Owner of the object
+     */
+    explicit ImageGridScaler(QObject *parent = 0);
+
+    /**
+     * @brief Destructor
+     *
+     * Cancels all jobs and waits for the running ones to finish
+     */
+    ~ImageGridScaler();
+
+    /**
+     * @brief Queue an image to be scaled
+     * @param id Id that scaled() will be emitted with
+     * @param source Image to scale
+     * @param size Exact size of the scaled image
+     */
+    void scale(quint64 id, const QImage &source, const QSize &size);
+
+    /**
+     * @brief Queue an image source to be decoded if needed and scaled
+     * @param id Id that scaled() will be emitted with
+     * @param source Image source to scale
+     * @param size Exact size of the scaled image
+     */
+    void scale(quint64 id, const QSharedPointer<ImageGridSource> &source, const QSize &size);
+
+    /**
+     * @brief Cancel all queued and running jobs
+     */
+    void cancel();
+
+    /**
+     * @brief Check if the current generation of a job has been cancelled
+     * @param generation Generation the job was started in
+     * @return True if cancelled
+     */
+    bool isCancelled(int generation) const;
+
+    /**
+     * @brief Set number of threads used for scaling
+     * @param count Number of threads
+     */
+    void setMaxThreadCount(int count);
+
+    /**
+     * @brief Set transformation mode used for scaling
+     *
+     * Qt::SmoothTransformation uses ImageGridResampler with filter(),
+     * Qt::FastTransformation uses QImage::scaled().
+     * Defaults to Qt::SmoothTransformation
+     * @param mode Transformation mode
+     */
+    void setTransformationMode(Qt::TransformationMode mode);
+
+    /**
+     * @brief Get transformation mode used for scaling
+     * @return Transformation mode
+     */
+    Qt::TransformationMode transformationMode() const;
+
+    /**
+     * @brief Set filter used with Qt::SmoothTransformation
+     *
+     * Defaults to ImageGridResampler::BoxFilter
+     * @param filter Resampling filter
+     */
+    void setFilter(ImageGridResampler::Filter filter);
+
+    /**
+     * @brief Get filter used with Qt::SmoothTransformation
+     * @return Resampling filter
+     */
+    ImageGridResampler::Filter filter() const;
+
+    /**
+     * @brief Get a value that tells scaling methods apart in cache keys
+     *
+     * Combines transformation mode and filter
+     * @return Scaling method
+     */
+    int method() const;
+
+    /**
+     * @brief Set the stats scale jobs are recorded to as ImageGridStats::ScalePhase
+     *
+     * Jobs keep the stats alive until they finish
+     * @param stats Stats, must not be null
+     */
+    void setStats(const QSharedPointer<ImageGridStats> &stats);
+
+signals:
+    /**
+     * @brief Emitted when an image has been scaled
+     * @param id Id the image was queued with
+     * @param image Scaled image
+     */
+    void scaled(quint64 id, const QImage &image);
+
+    /**
+     * @brief Emitted when an image could not be decoded or scaled
+     * @param id Id the image was queued with
+     * @param size Size the image was queued with
+     */
+    void failed(quint64 id, const QSize &size);
+};
+
+#endif // IMAGEGRIDSCALER_HPP
@@ -0,0 +1,406 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QAtomicInteger>
+#include <QBuffer>
+#include <QFile>
+#include <QIODevice>
+#include <QImageReader>
+#include <QList>
+#include <QMutexLocker>
+#include <QtMath>
+#include "imagegriddiskcache.hpp"
+#include "imagegridresampler.hpp"
+#include "imagegridsource.hpp"
+
+ImageGridSource::ImageGridSource(const qint64 key) :
+    path_(),
+    data_(),
+    size_(),
+    key_(key),
+    mutex_(),
+    levels_(),
+    keepOriginal_(true),
+    diskCache_()
+{
+
+}
+
+qint64 ImageGridSource::nextKey()
+{
+    // Icon cache keys are positive, so counting down never collides with them
+    static QAtomicInteger<qint64> key(0);
+    return key.fetchAndSubOrdered(1) - 1;
+}
+
+void ImageGridSource::setUpReader(QImageReader &reader, QBuffer &buffer) const
+{
+    if(data_.isEmpty()) {
+        reader.setFileName(path_);
+        return;
+    }
+
+    buffer.setData(data_);
+    buffer.open(QIODevice::ReadOnly);
+    reader.setDevice(&buffer);
+}
+
+bool ImageGridSource::readSize()
+{
+    QImageReader reader;
+    QBuffer buffer;
+    setUpReader(reader, buffer);
+    if(!reader.canRead()) {
+        return false;
+    }
+
+    size_ = reader.size();
+    if(size_.isValid()) {
+        return true;
+    }
+
+    // The format can't tell its size without decoding
+    const QImage image = reader.read();
+    levels_ = {image};
+    size_ = image.size();
+    return !image.isNull();
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromFile(const QString &path)
+{
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(nextKey()));
+    source->path_ = path;
+    if(!source->readSize()) {
+        qWarning("ImageGridSource::fromFile: Unreadable image: %s", qPrintable(path));
+        return {};
+    }
+
+    return source;
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromDevice(QIODevice *device)
+{
+    if(!device || !device->isReadable()) {
+        qWarning("ImageGridSource::fromDevice: Device is not readable");
+        return {};
+    }
+
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(nextKey()));
+    source->data_ = device->readAll();
+    if(source->data_.isEmpty() || !source->readSize()) {
+        qWarning("ImageGridSource::fromDevice: Unreadable image");
+        return {};
+    }
+
+    return source;
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromFile(const QString &path, const QSize &size,
+                                                          const QImage &thumbnail)
+{
+    if(size.isEmpty()) {
+        qWarning("ImageGridSource::fromFile: Empty size: %s", qPrintable(path));
+        return {};
+    }
+
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(nextKey()));
+    source->path_ = path;
+    source->size_ = size;
+    if(!thumbnail.isNull()) {
+        source->levels_ = {thumbnail};
+    }
+
+    return source;
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromData(const QByteArray &data, const QSize &size,
+                                                          const QImage &thumbnail)
+{
+    if(data.isEmpty() || size.isEmpty()) {
+        qWarning("ImageGridSource::fromData: Empty data or size");
+        return {};
+    }
+
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(nextKey()));
+    source->data_ = data;
+    source->size_ = size;
+    if(!thumbnail.isNull()) {
+        source->levels_ = {thumbnail};
+    }
+
+    return source;
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromImage(const QImage &image)
+{
+    if(image.isNull()) {
+        qWarning("ImageGridSource::fromImage: Null image");
+        return {};
+    }
+
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(nextKey()));
+    source->size_ = image.size();
+    source->levels_ = {image};
+    return source;
+}
+
+QSharedPointer<ImageGridSource> ImageGridSource::fromIcon(const QIcon &icon)
+{
+    if(icon.isNull()) {
+        qWarning("ImageGridSource::fromIcon: Null icon");
+        return {};
+    }
+
+    QSharedPointer<ImageGridSource> source(new ImageGridSource(icon.cacheKey()));
+    const QList<QSize> sizes = icon.availableSizes();
+    if(!sizes.isEmpty()) {
+        const QImage image = icon.pixmap(sizes.first()).toImage();
+        source->levels_ = {image};
+        source->size_ = image.size();
+    }
+
+    return source;
+}
+
+QString ImageGridSource::path() const
+{
+    return path_;
+}
+
+QByteArray ImageGridSource::data() const
+{
+    return data_;
+}
+
+QSize ImageGridSource::size() const
+{
+    return size_;
+}
+
+qint64 ImageGridSource::key() const
+{
+    return key_;
+}
+
+QImage ImageGridSource::image() const
+{
+    QMutexLocker locker(&mutex_);
+    const auto level = firstLevel();
+    return level < levels_.size() ? levels_.at(level) : QImage();
+}
+
+bool ImageGridSource::keepOriginal() const
+{
+    QMutexLocker locker(&mutex_);
+    return keepOriginal_;
+}
+
+void ImageGridSource::setKeepOriginal(const bool keep)
+{
+    QMutexLocker locker(&mutex_);
+    keepOriginal_ = keep;
+    if(!keep && levels_.size() > 1) {
+        levels_.first() = QImage();
+    }
+}
+
+QSharedPointer<ImageGridDiskCache> ImageGridSource::diskCache() const
+{
+    QMutexLocker locker(&mutex_);
+    return diskCache_;
+}
+
+void ImageGridSource::setDiskCache(const QSharedPointer<ImageGridDiskCache> &cache)
+{
+    QMutexLocker locker(&mutex_);
+    diskCache_ = cache;
+}
+
+qint64 ImageGridSource::bytes() const
+{
+    QMutexLocker locker(&mutex_);
+    qint64 total = 0;
+    for(const QImage &level : levels_) {
+        total += static_cast<qint64>(level.bytesPerLine()) * level.height();
+    }
+
+    return total;
+}
+
+void ImageGridSource::release()
+{
+    QMutexLocker locker(&mutex_);
+
+    // A thumbnail of a file that has gone away can't be made again
+    if(canDecode() && (path_.isEmpty() || QFile::exists(path_))) {
+        levels_.clear();
+    }
+}
+
+bool ImageGridSource::canDecode() const
+{
+    return !path_.isEmpty() || !data_.isEmpty();
+}
+
+int ImageGridSource::firstLevel() const
+{
+    auto level = 0;
+    while(level < levels_.size() && levels_.at(level).isNull()) {
+        ++level;
+    }
+
+    return level;
+}
+
+QImage ImageGridSource::readCached(const QSharedPointer<ImageGridDiskCache> &cache,
+                                   const double factor) const
+{
+    // Round up to a bucket so that nearby sizes share one thumbnail, the
+    // extra pixel covers rounding of the shorter side
+    const auto longest = qMax(size_.width(), size_.height());
+    const auto side = ImageGridDiskCache::bucket(qCeil(longest * factor) + 1);
+    if(side >= longest) {
+        return {};
+    }
+
+    QImage image = cache->find(path_, side);
+    if(!image.isNull()) {
+        return image;
+    }
+
+    QImageReader reader(path_);
+    reader.setScaledSize(size_.scaled(side, side, Qt::KeepAspectRatio));
+    image = reader.read();
+    if(image.isNull()) {
+        qWarning("ImageGridSource::readCached: %s", qPrintable(reader.errorString()));
+        return {};
+    }
+
+    cache->insert(path_, side, image);
+    return image;
+}
+
+QImage ImageGridSource::decode(const QSize &size,
+                               const QSharedPointer<ImageGridDiskCache> &cache) const
+{
+    // Decode just large enough to cover size without changing the aspect ratio
+    const auto factor = qMax(static_cast<double>(size.width()) / size_.width(),
+                             static_cast<double>(size.height()) / size_.height());
+    if(cache && data_.isEmpty() && factor < 1) {
+        const QImage image = readCached(cache, factor);
+        if(!image.isNull()) {
+            return image;
+        }
+    }
+
+    QImageReader reader;
+    QBuffer buffer;
+    setUpReader(reader, buffer);
+    if(factor < 1) {
+        reader.setScaledSize(QSize(qMin(size_.width(), qCeil(size_.width() * factor)),
+                                   qMin(size_.height(), qCeil(size_.height() * factor))));
+    }
+
+    const QImage image = reader.read();
+    if(image.isNull()) {
+        qWarning("ImageGridSource::decode: %s", qPrintable(reader.errorString()));
+    }
+
+    return image;
+}
+
+QImage ImageGridSource::image(const QSize &size, const bool keep) const
+{
+    QMutexLocker locker(&mutex_);
+    auto level = firstLevel();
+    const QSize largest = level < levels_.size() ? levels_.at(level).size() : QSize();
+    const auto covered = largest.width() >= size.width() && largest.height() >= size.height();
+    if(!covered && largest != size_ && canDecode()) {
+        // Other threads keep using the levels while this one decodes
+        const QImage fallback = level < levels_.size() ? levels_.at(level) : QImage();
+        const QSharedPointer<ImageGridDiskCache> cache = diskCache_;
+        locker.unlock();
+        const QImage image = decode(size, cache);
+        if(image.isNull()) {
+            return fallback;
+        }
+
+        // Levels of the smaller image are no longer needed, unless another
+        // thread has decoded a larger one meanwhile
+        locker.relock();
+        const auto first = firstLevel();
+        if(keep && (first == levels_.size() || levels_.at(first).width() < image.width())) {
+            levels_ = {image};
+        }
+
+        return image;
+    }
+
+    if(level == levels_.size()) {
+        return {};
+    }
+
+    // Walk down to the smallest level that still covers size
+    while(true) {
+        const QImage current = levels_.at(level);
+        const QSize half(current.width() / 2, current.height() / 2);
+        if(half.width() < size.width() || half.height() < size.height() || half.isEmpty()) {
+            break;
+        }
+
+        if(level + 1 == levels_.size()) {
+            if(!keep) {
+                break;
+            }
+
+            locker.unlock();
+            const QImage next = ImageGridResampler::scaled(current, half);
+            locker.relock();
+
+            // Start over if the levels were replaced or released meanwhile
+            if(level >= levels_.size() || levels_.at(level).cacheKey() != current.cacheKey()) {
+                level = firstLevel();
+                if(level == levels_.size()) {
+                    return next;
+                }
+
+                continue;
+            }
+
+            // Another thread may have added the same level meanwhile
+            if(level + 1 == levels_.size()) {
+                levels_.append(next);
+            }
+        }
+
+        ++level;
+    }
+
+    const QImage image = levels_.at(level);
+    if(!keepOriginal_ && levels_.size() > 1) {
+        levels_.first() = QImage();
+    }
+
+    return image;
+}
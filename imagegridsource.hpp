@@ -0,0 +1,306 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDSOURCE_HPP
+#define IMAGEGRIDSOURCE_HPP
+
+#include <QByteArray>
+#include <QIcon>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class ImageGridDiskCache;
+class QBuffer;
+class QIODevice;
+class QImageReader;
+
+/**
+ * @brief Source of a tile image that is decoded only as large as needed
+ *
+ * Sources read from a file or a device only read the image header up
+ * front. Pixels are decoded with QImageReader::setScaledSize() at the
+ * size a tile is shown at, which lets formats such as JPEG skip most
+ * of the work, and are decoded again only when a larger size is asked
+ * for. The largest decoded image is kept.
+ *
+ * Sources made from an image or an icon already hold their pixels.
+ *
+ * Below the decoded image the source keeps a chain of mip levels, each
+ * half the size of the one above. Levels are built on demand by the
+ * thread asking for a smaller image and scaling starts from the
+ * smallest level that still covers the target size. Once a level below
+ * it exists the decoded image itself can be dropped with
+ * setKeepOriginal(false); sources that read from a file or a device
+ * decode again if a larger size is asked for later.
+ *
+ * Sources that read from a file can share an ImageGridDiskCache. Their
+ * scaled decodes are then rounded up to the cache buckets and read
+ * back from disk the next time, instead of decoding the file again.
+ *
+ * All functions are thread-safe. The lock is only held while the levels
+ * are read or replaced, decoding and scaling run without it so that a
+ * thread asking for a level that exists never waits for another one
+ * that is decoding.
+ */
+class ImageGridSource
+{
+    //! File to decode from, empty if not read from a file
+    QString path_;
+
+    //! Encoded image data, empty if not read from a device
+    QByteArray data_;
+
+    //! Size of the full resolution image
+    QSize size_;
+
+    //! Key that identifies the source in pixmap caches
+    qint64 key_;
+
+    //! Guards levels_, keepOriginal_ and diskCache_
+    mutable QMutex mutex_;
+
+    //! Largest image decoded so far followed by its mip levels, the
+    //! first level is null once it has been dropped
+    mutable QVector<QImage> levels_;
+
+    //! If the largest image is kept once a mip level below it exists
+    bool keepOriginal_;
+
+    //! Thumbnails decoded from path_ on earlier runs, may be null
+    QSharedPointer<ImageGridDiskCache> diskCache_;
+
+    /**
+     * @brief Constructor
+     * @param key Cache key
+     */
+    explicit ImageGridSource(qint64 key);
+
+    /**
+     * @brief Point a reader at the encoded image
+     * @param reader Reader to set up
+     * @param buffer Buffer that holds the encoded data while reading
+     */
+    void setUpReader(QImageReader &reader, QBuffer &buffer) const;
+
+    /**
+     * @brief Check if pixels can be decoded again
+     * @return True if the source reads from a file or a device
+     */
+    bool canDecode() const;
+
+    /**
+     * @brief Get the largest image still kept
+     *
+     * Must be called with mutex_ locked
+     * @return Index of the level, levels_.size() if there are none
+     */
+    int firstLevel() const;
+
+    /**
+     * @brief Decode a scaled image of the file through the disk cache
+     *
+     * Must be called with mutex_ unlocked
+     * @param cache Disk cache, must not be null
+     * @param factor Scale factor the image is needed at, less than 1
+     * @return Image or null image if the cache doesn't help at this size
+     */
+    QImage readCached(const QSharedPointer<ImageGridDiskCache> &cache, double factor) const;
+
+    /**
+     * @brief Decode an image at least as large as size
+     *
+     * Must be called with mutex_ unlocked, only reads members that don't
+     * change after construction
+     * @param size Size the image will be scaled to
+     * @param cache Disk cache to read through, may be null
+     * @return Image or null image if decoding fails
+     */
+    QImage decode(const QSize &size, const QSharedPointer<ImageGridDiskCache> &cache) const;
+
+    /**
+     * @brief Read the size of the image from its header
+     * @return True if the image can be read
+     */
+    bool readSize();
+
+    /**
+     * @brief Get a key for a source without an icon
+     * @return Unique key
+     */
+    static qint64 nextKey();
+
+public:
+    /**
+     * @brief Create a source that decodes from a file
+     * @param path Image file
+     * @return Source or null if the file is not a readable image
+     */
+    static QSharedPointer<ImageGridSource> fromFile(const QString &path);
+
+    /**
+     * @brief Create a source that decodes from a device
+     *
+     * The remaining encoded data is read from the device immediately,
+     * so the device can be closed afterwards
+     * @param device Device open for reading
+     * @return Source or null if the data is not a readable image
+     */
+    static QSharedPointer<ImageGridSource> fromDevice(QIODevice *device);
+
+    /**
+     * @brief Create a source that decodes from a file, starting from a thumbnail
+     *
+     * Nothing is read from the file until an image larger than the
+     * thumbnail is asked for
+     * @param path Image file
+     * @param size Size of the full resolution image
+     * @param thumbnail Image to show until then, may be null
+     * @return Source or null if size is empty
+     */
+    static QSharedPointer<ImageGridSource> fromFile(const QString &path, const QSize &size,
+                                                    const QImage &thumbnail);
+
+    /**
+     * @brief Create a source that decodes from encoded data, starting from a thumbnail
+     *
+     * The data is not decoded until an image larger than the thumbnail
+     * is asked for
+     * @param data Encoded image data
+     * @param size Size of the full resolution image
+     * @param thumbnail Image to show until then, may be null
+     * @return Source or null if data or size is empty
+     */
+    static QSharedPointer<ImageGridSource> fromData(const QByteArray &data, const QSize &size,
+                                                    const QImage &thumbnail);
+
+    /**
+     * @brief Create a source for an image that is already decoded
+     * @param image Image
+     * @return Source or null if the image is null
+     */
+    static QSharedPointer<ImageGridSource> fromImage(const QImage &image);
+
+    /**
+     * @brief Create a source for the largest available size of an icon
+     *
+     * The source shares the cache key of the icon
+     * @param icon Icon
+     * @return Source or null if the icon is null
+     */
+    static QSharedPointer<ImageGridSource> fromIcon(const QIcon &icon);
+
+    /**
+     * @brief Get the file the source decodes from
+     * @return Path or empty string
+     */
+    QString path() const;
+
+    /**
+     * @brief Get the encoded data the source decodes from
+     * @return Data or empty array if not read from a device
+     */
+    QByteArray data() const;
+
+    /**
+     * @brief Get size of the full resolution image
+     * @return Size
+     */
+    QSize size() const;
+
+    /**
+     * @brief Get key that identifies the source in pixmap caches
+     * @return Key
+     */
+    qint64 key() const;
+
+    /**
+     * @brief Get the largest image kept
+     * @return Image, null if nothing has been decoded yet
+     */
+    QImage image() const;
+
+    /**
+     * @brief Check if the largest image is kept once mip levels exist
+     * @return True if kept
+     */
+    bool keepOriginal() const;
+
+    /**
+     * @brief Set if the largest image is kept once mip levels exist
+     *
+     * Dropping it saves three quarters of the memory the source uses, but an
+     * image made from an icon or an image can't be shown larger than
+     * its first mip level afterwards. Defaults to true
+     * @param keep True to keep it
+     */
+    void setKeepOriginal(bool keep);
+
+    /**
+     * @brief Get the disk cache scaled decodes are kept in
+     * @return Cache or null if there is none
+     */
+    QSharedPointer<ImageGridDiskCache> diskCache() const;
+
+    /**
+     * @brief Set the disk cache scaled decodes are kept in
+     *
+     * Only sources that read from a file use the cache
+     * @param cache Cache, null to decode without one
+     */
+    void setDiskCache(const QSharedPointer<ImageGridDiskCache> &cache);
+
+    /**
+     * @brief Get the memory used by the decoded image and its mip levels
+     * @return Size in bytes
+     */
+    qint64 bytes() const;
+
+    /**
+     * @brief Drop the decoded image and its mip levels
+     *
+     * Only sources that can decode their file or data again drop their
+     * pixels, the next image() call decodes at the size it asks for
+     */
+    void release();
+
+    /**
+     * @brief Get an image at least as large as size
+     *
+     * Decodes again if the largest image so far is smaller, otherwise
+     * returns the smallest mip level that covers size, building the
+     * levels that are missing. The returned image keeps the aspect
+     * ratio of the source and is never larger than the full resolution
+     * image.
+     * @param size Size the image will be scaled to
+     * @param keep If newly decoded images and mip levels are kept
+     * @return Image or null image if decoding fails
+     */
+    QImage image(const QSize &size, bool keep = true) const;
+};
+
+#endif // IMAGEGRIDSOURCE_HPP
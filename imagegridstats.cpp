@@ -0,0 +1,130 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#include <QMutexLocker>
+#include "imagegridstats.hpp"
+
+Q_LOGGING_CATEGORY(imageGridTiming, "imagegrid.timing", QtWarningMsg)
+
+ImageGridStats::ImageGridStats() :
+    enabled_(0),
+    mutex_(),
+    counters_()
+{
+
+}
+
+bool ImageGridStats::isEnabled() const
+{
+    return enabled_.load() != 0 || imageGridTiming().isDebugEnabled();
+}
+
+void ImageGridStats::setEnabled(const bool enabled)
+{
+    enabled_.store(enabled ? 1 : 0);
+}
+
+void ImageGridStats::record(const Phase phase, const qint64 ns, const int tiles)
+{
+    if(phase < 0 || phase >= PhaseCount) {
+        qWarning("ImageGridStats::record: Invalid phase: %d", phase);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        Counter &counter = counters_[phase];
+        ++counter.calls;
+        counter.totalNs += ns;
+        counter.maxNs = qMax(counter.maxNs, ns);
+        counter.tiles += tiles;
+    }
+
+    qCDebug(imageGridTiming, "%s: %lld us, %d tiles", phaseName(phase), ns / 1000, tiles);
+}
+
+ImageGridStats::Counter ImageGridStats::counter(const Phase phase) const
+{
+    if(phase < 0 || phase >= PhaseCount) {
+        qWarning("ImageGridStats::counter: Invalid phase: %d", phase);
+        return {};
+    }
+
+    QMutexLocker locker(&mutex_);
+    return counters_[phase];
+}
+
+void ImageGridStats::reset()
+{
+    QMutexLocker locker(&mutex_);
+    for(Counter &counter : counters_) {
+        counter = Counter();
+    }
+}
+
+const char *ImageGridStats::phaseName(const Phase phase)
+{
+    switch(phase) {
+    case InsertPhase:
+        return "insert";
+    case RemovePhase:
+        return "remove";
+    case ResizePhase:
+        return "resize";
+    case ScalePhase:
+        return "scale";
+    case PixmapPhase:
+        return "pixmap";
+    case HitTestPhase:
+        return "hit-test";
+    case PaintPhase:
+        return "paint";
+    default:
+        return "unknown";
+    }
+}
+
+ImageGridTimer::ImageGridTimer(ImageGridStats &stats, const ImageGridStats::Phase phase,
+                               const int tiles) :
+    stats_(stats.isEnabled() ? &stats : 0),
+    phase_(phase),
+    tiles_(tiles),
+    timer_()
+{
+    if(stats_) {
+        timer_.start();
+    }
+}
+
+ImageGridTimer::~ImageGridTimer()
+{
+    if(stats_) {
+        stats_->record(phase_, timer_.nsecsElapsed(), tiles_);
+    }
+}
+
+void ImageGridTimer::setTiles(const int tiles)
+{
+    tiles_ = tiles;
+}
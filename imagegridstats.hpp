@@ -0,0 +1,195 @@
+/******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 https://github.com/labyrinthofdreams
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+******************************************************************************/
+
+#ifndef IMAGEGRIDSTATS_HPP
+#define IMAGEGRIDSTATS_HPP
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QMutex>
+
+//! Logs the duration of every timed phase as a debug message
+Q_DECLARE_LOGGING_CATEGORY(imageGridTiming)
+
+/**
+ * @brief Call counts, durations and tile counts of the phases of a grid
+ *
+ * Recording is off by default and costs a single flag check per phase
+ * then. It is on while enabled with setEnabled() or while debug output
+ * of the imagegrid.timing logging category is enabled, for example with
+ * QT_LOGGING_RULES="imagegrid.timing.debug=true", which also logs every
+ * timed call.
+ *
+ * Phases are recorded from the GUI thread, except Scale which is
+ * recorded from the scaler threads. All functions are thread-safe.
+ */
+class ImageGridStats
+{
+public:
+    //! Phases that are timed
+    enum Phase {
+        //! Inserting tiles into the model and creating their widgets
+        InsertPhase,
+
+        //! Removing tiles and their widgets
+        RemovePhase,
+
+        //! Calculating tile sizes and queueing scale jobs for dirty rows
+        ResizePhase,
+
+        //! Decoding and scaling a tile image on a scaler thread
+        ScalePhase,
+
+        //! Converting a scaled image to a pixmap and showing it
+        PixmapPhase,
+
+        //! Finding the tile or drop position under the cursor
+        HitTestPhase,
+
+        //! Painting the widget
+        PaintPhase,
+
+        //! Number of phases
+        PhaseCount
+    };
+
+    //! Totals of a single phase
+    struct Counter {
+        //! Number of timed calls
+        quint64 calls;
+
+        //! Total duration of all calls in nanoseconds
+        qint64 totalNs;
+
+        //! Duration of the longest call in nanoseconds
+        qint64 maxNs;
+
+        //! Number of tiles handled by all calls
+        quint64 tiles;
+    };
+
+private:
+    //! If recording was turned on with setEnabled()
+    QAtomicInt enabled_;
+
+    //! Guards counters_
+    mutable QMutex mutex_;
+
+    //! Totals of each phase
+    Counter counters_[PhaseCount];
+
+public:
+    /**
+     * @brief Constructor
+     */
+    ImageGridStats();
+
+    /**
+     * @brief Check if phases are recorded
+     * @return True if enabled or timing debug output is on
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Turn recording on or off
+     *
+     * Recording stays on while timing debug output is on
+     * @param enabled True to record
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Add a timed call to a phase
+     * @param phase Phase
+     * @param ns Duration in nanoseconds
+     * @param tiles Number of tiles the call handled
+     */
+    void record(Phase phase, qint64 ns, int tiles);
+
+    /**
+     * @brief Get the totals of a phase
+     * @param phase Phase
+     * @return Totals
+     */
+    Counter counter(Phase phase) const;
+
+    /**
+     * @brief Reset the totals of every phase
+     */
+    void reset();
+
+    /**
+     * @brief Get the name of a phase
+     * @param phase Phase
+     * @return Name such as "resize"
+     */
+    static const char *phaseName(Phase phase);
+};
+
+/**
+ * @brief Times a scope and records it as a phase
+ *
+ * Does nothing but check ImageGridStats::isEnabled() when recording is off
+ */
+class ImageGridTimer
+{
+    //! Stats to record to, null when recording is off
+    ImageGridStats *stats_;
+
+    //! Phase being timed
+    ImageGridStats::Phase phase_;
+
+    //! Number of tiles handled
+    int tiles_;
+
+    //! Time since construction
+    QElapsedTimer timer_;
+
+public:
+    /**
+     * @brief Start timing a phase
+     * @param stats Stats to record to
+     * @param phase Phase being timed
+     * @param tiles Number of tiles handled
+     */
+    ImageGridTimer(ImageGridStats &stats, ImageGridStats::Phase phase, int tiles = 0);
+
+    /**
+     * @brief Record the phase
+     */
+    ~ImageGridTimer();
+
+    /**
+     * @brief Set the number of tiles handled when it's only known at the end
+     * @param tiles Number of tiles
+     */
+    void setTiles(int tiles);
+
+    ImageGridTimer(const ImageGridTimer &) = delete;
+
+    ImageGridTimer &operator=(const ImageGridTimer &) = delete;
+};
+
+#endif // IMAGEGRIDSTATS_HPP
@@ -22,348 +22,1873 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ******************************************************************************/
 
+#include <QAbstractScrollArea>
+#include <QApplication>
 #include <QBrush>
+#include <QByteArray>
+#include <QDataStream>
+#include <QDrag>
 #include <QDragEnterEvent>
 #include <QDragLeaveEvent>
 #include <QDragMoveEvent>
 #include <QDropEvent>
 #include <QHBoxLayout>
 #include <QIcon>
+#include <QKeyEvent>
 #include <QLabel>
 #include <QLayoutItem>
 #include <QListWidget>
+#include <QMimeData>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPaintEvent>
 #include <QPen>
 #include <QPixmap>
 #include <QPoint>
+#include <QRegion>
+#include <QResizeEvent>
+#include <QScrollBar>
+#include <QShowEvent>
 #include <QSize>
 #include <QSpacerItem>
+#include <QTimer>
+#include <QUndoStack>
 #include <QVBoxLayout>
+#include <QtMath>
+#include "imagegridcommands.hpp"
+#include "imagegridcompositor.hpp"
+#include "imagegriddiskcache.hpp"
+#include "imagegridimagewriter.hpp"
+#include "imagegridprojectfile.hpp"
+#include "imagegridscaler.hpp"
+#include "imagegridstats.hpp"
 #include "imagegridwidget.hpp"
 
+// TODO: Implement changing spacing
+// TODO: Drawing drop helper lines only work with 10px spacing
+// so we need to make it work with more or less pixels as well
+
 namespace {
 
-template <class T>
-T calculateHeight(const QPixmap &img, const T newWidth) {
-    return static_cast<double>(img.height()) / img.width() * newWidth;
+//! Mime type of tiles and rows dragged inside the grid
+const char TileMimeType[] = "application/x-imagegridwidget-tile";
+
+//! Longest side of the pixmap shown under the cursor while dragging
+const int DragPixmapSize = 128;
+
+//! Shortest time between two scheduled relayouts in milliseconds
+const int RelayoutInterval = 16;
+
+//! Visible area heights of rows given pixmaps ahead of the scroll direction
+const int PrefetchPages = 1;
+
+//! Visible area heights away from the visible area where rows drop their pixmaps
+const int KeepPages = 2;
+
+/**
+ * @brief Make an image source for every icon that isn't null
+ * @param icons Icons
+ * @param valid Icons that aren't null
+ * @param sources Source of each valid icon
+ */
+void readIcons(const QList<QIcon> &icons, QList<QIcon> *valid,
+               QList<QSharedPointer<ImageGridSource>> *sources)
+{
+    for(const QIcon &icon : icons) {
+        const QSharedPointer<ImageGridSource> source = ImageGridSource::fromIcon(icon);
+        if(source) {
+            valid->append(icon);
+            sources->append(source);
+        }
+    }
+}
+
+/**
+ * @brief Make an image source for every readable image file
+ * @param paths Image files
+ * @return Sources of the readable files
+ */
+QList<QSharedPointer<ImageGridSource>> readFiles(const QStringList &paths)
+{
+    QList<QSharedPointer<ImageGridSource>> sources;
+    for(const QString &path : paths) {
+        const QSharedPointer<ImageGridSource> source = ImageGridSource::fromFile(path);
+        if(source) {
+            sources.append(source);
+        }
+    }
+
+    return sources;
+}
+
+} // namespace
+
+ImageGridWidget::ImageGridWidget(QWidget *parent) :
+    ImageGridWidget(0, parent)
+{
+
+}
+
+ImageGridWidget::ImageGridWidget(const int spacing, QWidget *parent) :
+    QWidget(parent),
+    point_(),
+    layout_(new QVBoxLayout),
+    isDragging_(false),
+    indicator_(),
+    pressIndex_(-1, -1),
+    pressPos_(),
+    grid_(),
+    geometry_(),
+    gridLayout_(0, spacing),
+    referenceKey_(0),
+    resizeAll_(true),
+    rearrange_(false),
+    scaler_(new ImageGridScaler(this)),
+    renderMode_(LabelRendering),
+    targetRowHeight_(0),
+    keepOriginals_(true),
+    diskCache_(),
+    updateDepth_(0),
+    labels_(),
+    pixmaps_(),
+    targetSizes_(),
+    pending_(),
+    pixmapCache_(),
+    undoStack_(new QUndoStack(this)),
+    stats_(new ImageGridStats),
+    relayoutTimer_(new QTimer(this)),
+    lastResize_(),
+    followsWidth_(false),
+    progressive_(false),
+    refineTimer_(new QTimer(this)),
+    previews_(),
+    selection_(),
+    virtualized_(false),
+    lastVisibleTop_(0),
+    liveTiles_(),
+    pen_(QPen(QBrush(Qt::blue, Qt::SolidPattern), 1)),
+    backgroundColor_(Qt::transparent)
+{
+    layout_->setSpacing(spacing);
+    layout_->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding, QSizePolicy::Expanding));
+
+    setAcceptDrops(true);
+    setFocusPolicy(Qt::ClickFocus);
+    setLayout(layout_);
+    setMouseTracking(true);
+
+    scaler_->setStats(stats_);
+
+    relayoutTimer_->setSingleShot(true);
+    connect(relayoutTimer_, &QTimer::timeout, this, &ImageGridWidget::resizeWidgets);
+
+    refineTimer_->setSingleShot(true);
+    refineTimer_->setInterval(250);
+    connect(refineTimer_, &QTimer::timeout, this, &ImageGridWidget::refineTiles);
+    connect(scaler_, &ImageGridScaler::scaled, this, &ImageGridWidget::onTileScaled);
+    connect(scaler_, &ImageGridScaler::failed, this, &ImageGridWidget::onTileFailed);
+}
+
+int ImageGridWidget::getRowCount() const
+{
+    return grid_.rowCount();
+}
+
+int ImageGridWidget::getColumnCount(const int row) const
+{
+    if(row < 0) {
+        qWarning("ImageGridWidget::getColumnCount: Negative row: %d", row);
+        return 0;
+    }
+
+    return grid_.columnCount(row);
+}
+
+QIcon ImageGridWidget::iconAt(const int row, const int column) const
+{
+    return iconAt(qMakePair(row, column));
+}
+
+QIcon ImageGridWidget::iconAt(const ImageGridWidget::Index index) const
+{
+    return grid_.iconAt(index.first, index.second);
+}
+
+bool ImageGridWidget::canInsertBefore(const int row) const
+{
+    if(row < 0) {
+        qWarning("ImageGridWidget::insertBefore: Negative row: %d", row);
+        return false;
+    }
+
+    if(row > grid_.rowCount()) {
+        qWarning("ImageGridWidget::insertBefore: Invalid row: %d", row);
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageGridWidget::canInsertBefore(const Index index) const
+{
+    if(index.first < 0 || index.second < 0) {
+        qWarning("ImageGridWidget::insertBefore: Negative index: %dx%d",
+                 index.first, index.second);
+        return false;
+    }
+
+    if(index.first >= grid_.rowCount()
+            || index.second > grid_.columnCount(index.first)) {
+        qWarning("ImageGridWidget::insertBefore: Invalid index: %dx%d",
+                 index.first, index.second);
+        return false;
+    }
+
+    return true;
+}
+
+void ImageGridWidget::insertBefore(const int row, const QIcon &icon)
+{
+    if(!canInsertBefore(row)) {
+        return;
+    }
+
+    if(icon.isNull()) {
+        qWarning("ImageGridWidget::insertBefore: Null icon");
+        return;
+    }
+
+    grid_.insertRow(row, icon);
+    rowInserted(row);
+}
+
+void ImageGridWidget::insertBefore(const Index index, const QIcon &icon)
+{
+    if(!canInsertBefore(index)) {
+        return;
+    }
+
+    if(icon.isNull()) {
+        qWarning("ImageGridWidget::insertBefore: Null icon");
+        return;
+    }
+
+    grid_.insert(index.first, index.second, icon);
+    tileInserted(index);
+}
+
+void ImageGridWidget::insertBefore(const int row, const QSharedPointer<ImageGridSource> &source,
+                                   const QIcon &icon)
+{
+    if(!canInsertBefore(row)) {
+        return;
+    }
+
+    if(!source) {
+        qWarning("ImageGridWidget::insertBefore: Null source");
+        return;
+    }
+
+    grid_.insertRow(row, source, icon);
+    rowInserted(row);
+}
+
+void ImageGridWidget::insertBefore(const Index index, const QSharedPointer<ImageGridSource> &source,
+                                   const QIcon &icon)
+{
+    if(!canInsertBefore(index)) {
+        return;
+    }
+
+    if(!source) {
+        qWarning("ImageGridWidget::insertBefore: Null source");
+        return;
+    }
+
+    grid_.insert(index.first, index.second, source, icon);
+    tileInserted(index);
+}
+
+void ImageGridWidget::rowInserted(const int row)
+{
+    {
+        ImageGridTimer timer(*stats_, ImageGridStats::InsertPhase, 1);
+        grid_.sourceAt(row, 0)->setKeepOriginal(keepOriginals_);
+        grid_.sourceAt(row, 0)->setDiskCache(diskCache_);
+        geometry_.insertRow(row);
+        rearrange_ = true;
+
+        // Insert icon into the layout, resizeWidgets() sets the pixmap
+        if(renderMode_ == LabelRendering) {
+            insertRowWidgets(row);
+        }
+    }
+
+    resizeWidgets();
+}
+
+void ImageGridWidget::tileInserted(const Index index)
+{
+    {
+        ImageGridTimer timer(*stats_, ImageGridStats::InsertPhase, 1);
+        grid_.sourceAt(index.first, index.second)->setKeepOriginal(keepOriginals_);
+        grid_.sourceAt(index.first, index.second)->setDiskCache(diskCache_);
+        rearrange_ = true;
+
+        // Insert icon into the layout, resizeWidgets() sets the pixmap
+        if(renderMode_ == LabelRendering) {
+            auto label = new QLabel;
+            auto lo = qobject_cast<QHBoxLayout *>(layout_->itemAt(index.first)->layout());
+            lo->insertWidget(index.second, label);
+            labels_.insert(grid_.idAt(index.first, index.second), label);
+        }
+    }
+
+    resizeWidgets();
+}
+
+quint64 ImageGridWidget::insertTile(int row, int column, bool newRow, const int position,
+                                    const QIcon &icon,
+                                    const QSharedPointer<ImageGridSource> &source,
+                                    const quint64 id)
+{
+    if(!source) {
+        qWarning("ImageGridWidget::insertTile: Null source");
+        return 0;
+    }
+
+    // Arranged rows are split again after every edit (see rearrange_), so
+    // only the order of the tiles is stable
+    if(targetRowHeight_ > 0) {
+        const Index index = indexAt(position);
+        row = index.first;
+        column = index.second;
+        newRow = row == grid_.rowCount();
+    }
+
+    // Nothing was inserted if the tile count doesn't change
+    const auto count = grid_.tileCount();
+    beginUpdate();
+    if(newRow) {
+        if(canInsertBefore(row)) {
+            grid_.insertRow(row, source, icon, id);
+            rowInserted(row);
+        }
+    }
+    else if(canInsertBefore(qMakePair(row, column))) {
+        grid_.insert(row, column, source, icon, id);
+        tileInserted(qMakePair(row, column));
+    }
+
+    const auto inserted = grid_.tileCount() == count ? 0 : grid_.idAt(row, newRow ? 0 : column);
+    endUpdate();
+    return inserted;
+}
+
+void ImageGridWidget::removeTile(const quint64 id, const Index hint)
+{
+    const Index index = indexOf(id, hint);
+    if(index.first < 0) {
+        qWarning("ImageGridWidget::removeTile: No such tile: %llu", id);
+        return;
+    }
+
+    if(grid_.columnCount(index.first) == 1) {
+        removeAt(index.first);
+    }
+    else {
+        removeAt(index);
+    }
+
+    resizeWidgets();
+}
+
+void ImageGridWidget::moveTile(const Index from, const Index to, const bool newRow)
+{
+    const auto id = grid_.idAt(from.first, from.second);
+    const auto removesRow = grid_.columnCount(from.first) == 1;
+    if(!grid_.move(from.first, from.second, to.first, to.second, newRow)) {
+        return;
+    }
+
+    rearrange_ = true;
+
+    // The label keeps its pixmap, only the row layout it sits in changes
+    if(renderMode_ == LabelRendering) {
+        QLabel *label = labels_.value(id);
+        layout_->itemAt(from.first)->layout()->removeWidget(label);
+        if(removesRow) {
+            removeRowWidgets(from.first);
+        }
+
+        if(newRow) {
+            auto lo = new QHBoxLayout;
+            lo->addWidget(label);
+            lo->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding));
+            layout_->insertLayout(to.first, lo);
+        }
+        else {
+            auto lo = qobject_cast<QHBoxLayout *>(layout_->itemAt(to.first)->layout());
+            lo->insertWidget(to.second, label);
+        }
+    }
+
+    if(removesRow) {
+        geometry_.removeRow(from.first);
+    }
+
+    if(newRow) {
+        geometry_.insertRow(to.first);
+    }
+
+    resizeWidgets();
+}
+
+void ImageGridWidget::moveRow(const int row, const int toRow)
+{
+    if(!grid_.moveRow(row, toRow)) {
+        return;
+    }
+
+    rearrange_ = true;
+
+    if(renderMode_ == LabelRendering) {
+        QLayout *lo = layout_->takeAt(row)->layout();
+        layout_->insertLayout(toRow, lo);
+    }
+
+    // Tiles keep their size so the row is only placed again, not rescaled
+    geometry_.removeRow(row);
+    geometry_.insertRow(toRow);
+    resizeWidgets();
+}
+
+void ImageGridWidget::startDrag(const Qt::KeyboardModifiers modifiers)
+{
+    const Index index = pressIndex_;
+    pressIndex_ = qMakePair(-1, -1);
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << index.first << index.second << modifiers.testFlag(Qt::ShiftModifier);
+
+    auto mimeData = new QMimeData;
+    mimeData->setData(TileMimeType, data);
+
+    auto drag = new QDrag(this);
+    drag->setMimeData(mimeData);
+    const QPixmap pixmap = pixmaps_.value(grid_.idAt(index.first, index.second));
+    if(!pixmap.isNull()) {
+        const QSize size = pixmap.size().boundedTo(QSize(DragPixmapSize, DragPixmapSize));
+        drag->setPixmap(pixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    }
+
+    drag->exec(Qt::MoveAction);
+}
+
+void ImageGridWidget::dropMove(QDropEvent *event)
+{
+    auto row = 0;
+    auto column = 0;
+    auto wholeRow = false;
+    QDataStream stream(event->mimeData()->data(TileMimeType));
+    stream >> row >> column >> wholeRow;
+    if(!grid_.isValid(row, column)) {
+        qWarning("ImageGridWidget::dropEvent: Invalid index: %dx%d", row, column);
+        return;
+    }
+
+    // Destinations are relative to the grid without the moved tile or row
+    const ImageGridLayout::DropTarget target = ImageGridLayout::dropTarget(geometry_, point_);
+    if(wholeRow) {
+        // Arranged rows are split again after the move, so a dragged row
+        // wouldn't stay together and its move couldn't be undone
+        if(targetRowHeight_ > 0) {
+            return;
+        }
+
+        // Rows only go between rows
+        const auto toRow = target.row > row ? target.row - 1 : target.row;
+        if(target.newRow && toRow != row) {
+            undoStack_->push(new ImageGridMoveRowCommand(this, row, toRow));
+        }
+
+        return;
+    }
+
+    const auto removesRow = grid_.columnCount(row) == 1;
+    auto toRow = target.row;
+    auto toColumn = target.column;
+    if(target.newRow) {
+        if(removesRow && toRow > row) {
+            --toRow;
+        }
+
+        if(removesRow && toRow == row) {
+            return;
+        }
+    }
+    else if(toRow == row) {
+        if(removesRow) {
+            return;
+        }
+
+        if(toColumn > column) {
+            --toColumn;
+        }
+
+        if(toColumn == column) {
+            return;
+        }
+    }
+    else if(removesRow && toRow > row) {
+        --toRow;
+    }
+
+    undoStack_->push(new ImageGridMoveCommand(this, row, column, toRow, toColumn,
+                                              target.newRow));
+}
+
+ImageGridWidget::Index ImageGridWidget::indexOf(const quint64 id, const Index hint) const
+{
+    if(grid_.idAt(hint.first, hint.second) == id) {
+        return hint;
+    }
+
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            if(grid_.idAt(row, col) == id) {
+                return qMakePair(row, col);
+            }
+        }
+    }
+
+    return qMakePair(-1, -1);
+}
+
+int ImageGridWidget::positionOf(const Index index) const
+{
+    auto position = index.second;
+    for(auto row = 0; row < index.first; ++row) {
+        position += grid_.columnCount(row);
+    }
+
+    return position;
+}
+
+ImageGridWidget::Index ImageGridWidget::indexAt(int position) const
+{
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        if(position <= cols) {
+            return qMakePair(row, position);
+        }
+
+        position -= cols;
+    }
+
+    return qMakePair(rows, 0);
+}
+
+int ImageGridWidget::addInserts(QUndoCommand *batch, const int row, const int column,
+                                const bool newRow, const QList<QIcon> &icons,
+                                const QList<QSharedPointer<ImageGridSource>> &sources)
+{
+    const auto count = sources.size();
+    for(auto idx = 0; idx < count; ++idx) {
+        new ImageGridInsertCommand(this, row, column + idx, newRow && idx == 0,
+                                   icons.value(idx), sources.at(idx), batch);
+    }
+
+    return count;
+}
+
+void ImageGridWidget::removeAll(QUndoCommand *batch)
+{
+    if(!grid_.isEmpty()) {
+        new ImageGridRemoveTilesCommand(this, indexesOf(0, grid_.rowCount()),
+                                        tr("Remove images"), batch);
+    }
+}
+
+QList<ImageGridWidget::Index> ImageGridWidget::indexesOf(const int row, const int count) const
+{
+    QList<Index> indexes;
+    for(auto r = row; r < row + count; ++r) {
+        const auto cols = grid_.columnCount(r);
+        for(auto col = 0; col < cols; ++col) {
+            indexes.append(qMakePair(r, col));
+        }
+    }
+
+    return indexes;
+}
+
+void ImageGridWidget::removeIds(const QSet<quint64> &ids)
+{
+    if(ids.isEmpty()) {
+        return;
+    }
+
+    {
+        ImageGridTimer timer(*stats_, ImageGridStats::RemovePhase, ids.size());
+        const auto selected = selection_.size();
+
+        // Rows losing every tile go away, rows losing some are rebuilt
+        QVector<int> affected;
+        QVector<int> emptied;
+        const auto rows = grid_.rowCount();
+        for(auto row = 0; row < rows; ++row) {
+            const auto cols = grid_.columnCount(row);
+            auto removed = 0;
+            for(auto col = 0; col < cols; ++col) {
+                const auto id = grid_.idAt(row, col);
+                if(ids.contains(id)) {
+                    forgetTile(id);
+                    ++removed;
+                }
+            }
+
+            if(removed > 0) {
+                affected.append(row);
+            }
+
+            if(removed == cols) {
+                emptied.append(row);
+            }
+        }
+
+        // Labels are deleted right away so their pixmaps are freed now
+        // and not one deleteLater() at a time on the next event loop turn
+        if(renderMode_ == LabelRendering) {
+            setUpdatesEnabled(false);
+            QList<QWidget *> widgets;
+            for(auto idx = affected.size() - 1; idx >= 0; --idx) {
+                takeRowWidgets(affected.at(idx), &widgets);
+            }
+
+            qDeleteAll(widgets);
+        }
+
+        grid_.removeTiles(ids);
+        geometry_.removeRows(emptied);
+        rearrange_ = true;
+
+        if(renderMode_ == LabelRendering) {
+            auto removedBefore = 0;
+            for(const auto row : affected) {
+                if(removedBefore < emptied.size() && emptied.at(removedBefore) == row) {
+                    ++removedBefore;
+                    continue;
+                }
+
+                insertRowWidgets(row - removedBefore);
+            }
+
+            setUpdatesEnabled(true);
+        }
+
+        // Nothing is left to scale for
+        if(grid_.isEmpty()) {
+            scaler_->cancel();
+        }
+
+        if(selection_.size() != selected) {
+            emit selectionChanged();
+        }
+    }
+
+    resizeWidgets();
+}
+
+void ImageGridWidget::pushBatch(QUndoCommand *batch)
+{
+    if(batch->childCount() == 0) {
+        delete batch;
+        return;
+    }
+
+    undoStack_->push(batch);
+}
+
+bool ImageGridWidget::insertImage(const int row, const QString &path)
+{
+    if(!canInsertBefore(row)) {
+        return false;
+    }
+
+    const QSharedPointer<ImageGridSource> source = ImageGridSource::fromFile(path);
+    if(!source) {
+        return false;
+    }
+
+    undoStack_->push(new ImageGridInsertCommand(this, row, 0, true, QIcon(), source));
+    return true;
+}
+
+bool ImageGridWidget::insertImage(const int row, QIODevice *device)
+{
+    if(!canInsertBefore(row)) {
+        return false;
+    }
+
+    const QSharedPointer<ImageGridSource> source = ImageGridSource::fromDevice(device);
+    if(!source) {
+        return false;
+    }
+
+    undoStack_->push(new ImageGridInsertCommand(this, row, 0, true, QIcon(), source));
+    return true;
+}
+
+bool ImageGridWidget::insertImage(const int row, const int column, const QString &path)
+{
+    if(!canInsertBefore(qMakePair(row, column))) {
+        return false;
+    }
+
+    const QSharedPointer<ImageGridSource> source = ImageGridSource::fromFile(path);
+    if(!source) {
+        return false;
+    }
+
+    undoStack_->push(new ImageGridInsertCommand(this, row, column, false, QIcon(), source));
+    return true;
+}
+
+bool ImageGridWidget::insertImage(const int row, const int column, QIODevice *device)
+{
+    if(!canInsertBefore(qMakePair(row, column))) {
+        return false;
+    }
+
+    const QSharedPointer<ImageGridSource> source = ImageGridSource::fromDevice(device);
+    if(!source) {
+        return false;
+    }
+
+    undoStack_->push(new ImageGridInsertCommand(this, row, column, false, QIcon(), source));
+    return true;
+}
+
+void ImageGridWidget::resizeWidgets()
+{
+    // endUpdate() resizes everything the batch changed at once
+    if(updateDepth_ > 0) {
+        return;
+    }
+
+    // A scheduled relayout has nothing left to do after this one
+    relayoutTimer_->stop();
+    lastResize_.start();
+
+    ImageGridTimer timer(*stats_, ImageGridStats::ResizePhase);
+    if(grid_.isEmpty()) {
+        geometry_.reset(layout_->spacing());
+        grid_.clearDirty();
+        resizeAll_ = false;
+        rearrange_ = false;
+        if(renderMode_ == PaintedRendering) {
+            updateGeometry();
+            update();
+        }
+
+        return;
+    }
+
+    // Every row size is relative to the first image
+    if(grid_.keyAt(0, 0) != referenceKey_) {
+        referenceKey_ = grid_.keyAt(0, 0);
+        gridLayout_.setReferenceSize(grid_.sizeAt(0, 0));
+        resizeAll_ = true;
+    }
+
+    if(resizeAll_) {
+        if(targetRowHeight_ > 0) {
+            arrangeRows();
+        }
+
+        // Jobs still running for the old layout are no longer needed
+        scaler_->cancel();
+        for(auto it = pending_.cbegin(); it != pending_.cend(); ++it) {
+            targetSizes_.remove(it.key());
+        }
+
+        pending_.clear();
+
+        geometry_.reset(layout_->spacing());
+        for(auto row = 0; row < grid_.rowCount(); ++row) {
+            geometry_.insertRow(row);
+        }
+
+        grid_.markAllDirty();
+        resizeAll_ = false;
+    }
+    else if(rearrange_ && targetRowHeight_ > 0) {
+        // Edits only keep the order of the tiles, the rows are split again
+        // around it. Tiles whose size doesn't change keep their pixmaps
+        // and running jobs
+        arrangeRows();
+        geometry_.reset(layout_->spacing());
+        for(auto row = 0; row < grid_.rowCount(); ++row) {
+            geometry_.insertRow(row);
+        }
+
+        grid_.markAllDirty();
+    }
+
+    rearrange_ = false;
+    if(!grid_.hasDirtyRows()) {
+        return;
+    }
+
+    const auto rows = grid_.rowCount();
+    auto tiles = 0;
+    for(auto row = 0; row < rows; ++row) {
+        if(grid_.isDirty(row)) {
+            resizeRow(row);
+            tiles += grid_.columnCount(row);
+        }
+    }
+
+    timer.setTiles(tiles);
+    grid_.clearDirty();
+
+    // Only now is the height of every row known
+    updateLiveRows();
+
+    // Refine once the layout has stopped changing for a while
+    if(!previews_.isEmpty()) {
+        refineTimer_->start();
+    }
+
+    if(renderMode_ == PaintedRendering) {
+        updateGeometry();
+        update();
+    }
+}
+
+void ImageGridWidget::scheduleResize()
+{
+    // The relayout already scheduled picks up this change as well
+    if(relayoutTimer_->isActive()) {
+        return;
+    }
+
+    const auto elapsed = lastResize_.isValid() ? lastResize_.elapsed() : RelayoutInterval;
+    relayoutTimer_->start(static_cast<int>(qMax<qint64>(0, RelayoutInterval - elapsed)));
+}
+
+void ImageGridWidget::followWidth()
+{
+    // Labels sit inside the layout margins, painted tiles start at the edge
+    const QMargins margins = renderMode_ == LabelRendering ?
+                layout_->contentsMargins() : QMargins();
+    const auto available = qMax(0, width() - margins.left() - margins.right());
+    if(available == gridLayout_.width()) {
+        return;
+    }
+
+    gridLayout_.setWidth(available);
+    resizeAll_ = true;
+
+    scheduleResize();
+}
+
+void ImageGridWidget::updateSizeConstraint()
+{
+    // Size comes from sizeHint() instead of the layout, which also lets
+    // labels overflow a shrinking widget until the next relayout
+    if(renderMode_ == PaintedRendering || followsWidth_) {
+        layout_->setSizeConstraint(QLayout::SetNoConstraint);
+        setMinimumSize(0, 0);
+    }
+    else {
+        layout_->setSizeConstraint(QLayout::SetDefaultConstraint);
+    }
+
+    updateGeometry();
+}
+
+void ImageGridWidget::resizeRow(const int row)
+{
+    const QVector<QSize> sizes = gridLayout_.rowSizes(grid_, row);
+    const auto count = sizes.size();
+    QVector<int> widths;
+    widths.reserve(count);
+    for(const QSize &size : sizes) {
+        widths.append(size.width());
+    }
+
+    geometry_.setRow(row, count == 0 ? 0 : sizes.first().height(), widths);
+
+    // Virtual rows get their pixmaps from updateLiveRows() when in view
+    if(!hasVirtualRows()) {
+        loadRowPixmaps(row, sizes);
+    }
+}
+
+void ImageGridWidget::loadRowPixmaps(const int row, const QVector<QSize> &sizes)
+{
+    const auto count = sizes.size();
+    QPixmap placeholder;
+    for(auto idx = 0; idx < count; ++idx) {
+        const QSize &size = sizes.at(idx);
+
+        // Labels always show their own icon so a label that already
+        // has (or is waiting for) an image of the right size is left alone
+        const auto id = grid_.idAt(row, idx);
+        if(targetSizes_.value(id) == size) {
+            continue;
+        }
+
+        targetSizes_.insert(id, size);
+        previews_.remove(id);
+        const ImageGridPixmapCache::Key key{grid_.keyAt(row, idx), size,
+                                            scaler_->method()};
+        QPixmap cached;
+        if(pixmapCache_.find(key, &cached)) {
+            pending_.remove(id);
+            setTilePixmap(id, cached);
+            continue;
+        }
+
+        // Thumbnails loaded from a project usually have the right size already
+        const QImage kept = grid_.imageAt(row, idx);
+        if(kept.size() == size) {
+            cached = QPixmap::fromImage(kept);
+            pixmapCache_.insert(key, cached);
+            pending_.remove(id);
+            setTilePixmap(id, cached);
+            continue;
+        }
+
+        // A quick preview is shown until refineTiles() replaces it
+        if(progressive_) {
+            const QPixmap current = pixmaps_.value(id);
+            QPixmap preview;
+            if(!current.isNull()) {
+                preview = current.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+            }
+            else if(!kept.isNull()) {
+                preview = QPixmap::fromImage(kept.scaled(size, Qt::IgnoreAspectRatio,
+                                                         Qt::FastTransformation));
+            }
+
+            if(!preview.isNull()) {
+                // A job still running for the old size is stale
+                pending_.remove(id);
+                previews_.insert(id, grid_.sourceAt(row, idx));
+                setTilePixmap(id, preview);
+                continue;
+            }
+        }
+
+        if(placeholder.size() != size) {
+            placeholder = QPixmap(size);
+            placeholder.fill(palette().color(QPalette::Midlight));
+        }
+
+        setTilePixmap(id, placeholder);
+        pending_.insert(id, key.source);
+        scaler_->scale(id, grid_.sourceAt(row, idx), size);
+    }
+}
+
+void ImageGridWidget::releaseTile(const quint64 id,
+                                  const QSharedPointer<ImageGridSource> &source)
+{
+    // A job still running for the tile is dropped by onTileScaled()
+    targetSizes_.remove(id);
+    pixmaps_.remove(id);
+    pending_.remove(id);
+    previews_.remove(id);
+    source->release();
+}
+
+void ImageGridWidget::trackLiveTiles()
+{
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            const auto id = grid_.idAt(row, col);
+            if(targetSizes_.contains(id)) {
+                liveTiles_.insert(id, grid_.sourceAt(row, col));
+            }
+        }
+    }
+}
+
+bool ImageGridWidget::hasVirtualRows() const
+{
+    return virtualized_ && renderMode_ == PaintedRendering;
+}
+
+void ImageGridWidget::updateLiveRows()
+{
+    // endUpdate() updates the rows once the batch is laid out
+    if(!hasVirtualRows() || updateDepth_ > 0) {
+        return;
+    }
+
+    const QRect visible = visibleRegion().boundingRect();
+    if(visible.isEmpty()) {
+        return;
+    }
+
+    const auto page = visible.height();
+    const auto down = visible.top() >= lastVisibleTop_;
+    lastVisibleTop_ = visible.top();
+
+    // Rows in view and a page ahead in the scroll direction get pixmaps
+    const auto rows = grid_.rowCount();
+    const auto top = visible.top() - (down ? 0 : PrefetchPages * page);
+    const auto bottom = visible.bottom() + (down ? PrefetchPages * page : 0);
+    const auto last = qMin(rows - 1, geometry_.vertical(bottom).second);
+    for(auto row = geometry_.vertical(top).second; row <= last; ++row) {
+        loadRowPixmaps(row, gridLayout_.rowSizes(grid_, row));
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            liveTiles_.insert(grid_.idAt(row, col), grid_.sourceAt(row, col));
+        }
+    }
+
+    // Rows far enough away that scrolling back takes a while drop theirs.
+    // Only the kept rows and the tiles that have a pixmap are looked at,
+    // so the cost doesn't grow with the size of the grid
+    const auto keepFirst = geometry_.vertical(visible.top() - KeepPages * page).second;
+    const auto keepLast = qMin(rows - 1,
+                               geometry_.vertical(visible.bottom() + KeepPages * page).second);
+    QSet<quint64> kept;
+    for(auto row = keepFirst; row <= keepLast; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            kept.insert(grid_.idAt(row, col));
+        }
+    }
+
+    for(auto it = liveTiles_.begin(); it != liveTiles_.end();) {
+        if(kept.contains(it.key())) {
+            ++it;
+            continue;
+        }
+
+        releaseTile(it.key(), it.value());
+        it = liveTiles_.erase(it);
+    }
+
+    if(!previews_.isEmpty()) {
+        refineTimer_->start();
+    }
+}
+
+void ImageGridWidget::refineTiles()
+{
+    for(auto it = previews_.cbegin(); it != previews_.cend(); ++it) {
+        const auto id = it.key();
+        const QSize size = targetSizes_.value(id);
+        const ImageGridPixmapCache::Key key{it.value()->key(), size, scaler_->method()};
+        QPixmap cached;
+        if(pixmapCache_.find(key, &cached)) {
+            setTilePixmap(id, cached);
+            continue;
+        }
+
+        // Jobs made stale by a newer layout are cancelled with scaler_->cancel()
+        // or dropped by onTileScaled()
+        pending_.insert(id, key.source);
+        scaler_->scale(id, it.value(), size);
+    }
+
+    previews_.clear();
+}
+
+void ImageGridWidget::arrangeRows()
+{
+    QVector<QSize> images;
+    images.reserve(grid_.tileCount());
+    for(auto row = 0; row < grid_.rowCount(); ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            images.append(grid_.sizeAt(row, col));
+        }
+    }
+
+    const QVector<int> columns = gridLayout_.partition(images, targetRowHeight_);
+    if(columns.isEmpty()) {
+        return;
+    }
+
+    // Labels are recreated with the pixmaps their tiles already have
+    if(renderMode_ == LabelRendering) {
+        for(auto row = grid_.rowCount() - 1; row >= 0; --row) {
+            removeRowWidgets(row);
+        }
+
+        labels_.clear();
+    }
+
+    grid_.rearrange(columns);
+
+    if(renderMode_ == LabelRendering) {
+        for(auto row = 0; row < grid_.rowCount(); ++row) {
+            insertRowWidgets(row);
+        }
+    }
+}
+
+void ImageGridWidget::removeAt(const ImageGridWidget::Index index)
+{
+    if(grid_.columnCount(index.first) == 1) {
+        removeAt(index.first);
+        return;
+    }
+
+    ImageGridTimer timer(*stats_, ImageGridStats::RemovePhase, 1);
+    const auto id = grid_.idAt(index.first, index.second);
+    if(renderMode_ == LabelRendering) {
+        QLabel *label = labels_.value(id);
+        layout_->itemAt(index.first)->layout()->removeWidget(label);
+        label->deleteLater();
+    }
+
+    forgetTile(id);
+    grid_.remove(index.first, index.second);
+    rearrange_ = true;
+}
+
+void ImageGridWidget::removeAt(const int row)
+{
+    const auto cols = grid_.columnCount(row);
+    ImageGridTimer timer(*stats_, ImageGridStats::RemovePhase, cols);
+    for(auto col = 0; col < cols; ++col) {
+        forgetTile(grid_.idAt(row, col));
+    }
+
+    if(renderMode_ == LabelRendering) {
+        removeRowWidgets(row);
+    }
+
+    grid_.removeRow(row);
+    geometry_.removeRow(row);
+    rearrange_ = true;
+}
+
+void ImageGridWidget::forgetTile(const quint64 id)
+{
+    selection_.remove(id);
+    labels_.remove(id);
+    previews_.remove(id);
+    pixmaps_.remove(id);
+    targetSizes_.remove(id);
+    pending_.remove(id);
+    liveTiles_.remove(id);
+}
+
+void ImageGridWidget::setTilePixmap(const quint64 id, const QPixmap &pixmap)
+{
+    pixmaps_.insert(id, pixmap);
+    if(renderMode_ == LabelRendering) {
+        labels_.value(id)->setPixmap(pixmap);
+    }
+    else {
+        update();
+    }
+}
+
+void ImageGridWidget::insertRowWidgets(const int row)
+{
+    auto lo = new QHBoxLayout;
+    const auto cols = grid_.columnCount(row);
+    for(auto col = 0; col < cols; ++col) {
+        const auto id = grid_.idAt(row, col);
+        auto label = new QLabel;
+        label->setPixmap(pixmaps_.value(id));
+        lo->addWidget(label);
+        labels_.insert(id, label);
+    }
+
+    lo->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding));
+    layout_->insertLayout(row, lo);
+}
+
+void ImageGridWidget::removeRowWidgets(const int row)
+{
+    QList<QWidget *> widgets;
+    takeRowWidgets(row, &widgets);
+    for(QWidget *widget : widgets) {
+        widget->deleteLater();
+    }
+}
+
+void ImageGridWidget::takeRowWidgets(const int row, QList<QWidget *> *widgets)
+{
+    // Remove labels and spacer item, then the row layout itself
+    QLayout *lo = layout_->takeAt(row)->layout();
+    while(QLayoutItem *item = lo->takeAt(0)) {
+        if(QWidget *widget = item->widget()) {
+            widgets->append(widget);
+        }
+
+        delete item;
+    }
+
+    delete lo;
+}
+
+int ImageGridWidget::paintTiles(QPainter &painter, const QRect &rect) const
+{
+    auto painted = 0;
+    const auto rows = geometry_.rowCount();
+    for(auto row = geometry_.vertical(rect.top()).second; row < rows; ++row) {
+        if(geometry_.tileRect(row, 0).top() > rect.bottom()) {
+            break;
+        }
+
+        const auto cols = geometry_.columnCount(row);
+        for(auto col = geometry_.horizontal(row, rect.left()).second; col < cols; ++col) {
+            const QRect tile = geometry_.tileRect(row, col);
+            if(tile.left() > rect.right()) {
+                break;
+            }
+
+            painter.drawPixmap(tile.topLeft(), pixmaps_.value(grid_.idAt(row, col)));
+            ++painted;
+        }
+    }
+
+    return painted;
+}
+
+void ImageGridWidget::paintSelection(QPainter &painter, const QRect &rect) const
+{
+    // Outlines sit in the spacing around the tile so labels don't cover them
+    painter.setPen(pen_);
+    painter.setBrush(Qt::NoBrush);
+    const auto rows = geometry_.rowCount();
+    for(auto row = geometry_.vertical(rect.top()).second; row < rows; ++row) {
+        if(geometry_.tileRect(row, 0).top() > rect.bottom() + 1) {
+            break;
+        }
+
+        const auto cols = geometry_.columnCount(row);
+        for(auto col = geometry_.horizontal(row, rect.left()).second; col < cols; ++col) {
+            const QRect tile = geometry_.tileRect(row, col);
+            if(tile.left() > rect.right() + 1) {
+                break;
+            }
+
+            if(selection_.contains(grid_.idAt(row, col))) {
+                painter.drawRect(tile.adjusted(-1, -1, 0, 0));
+            }
+        }
+    }
+}
+
+void ImageGridWidget::onTileScaled(const quint64 id, const QImage &image)
+{
+    // The tile may have been removed or resized since the job was queued
+    if(!pending_.contains(id) || targetSizes_.value(id) != image.size()) {
+        return;
+    }
+
+    ImageGridTimer timer(*stats_, ImageGridStats::PixmapPhase, 1);
+    const QPixmap pm = QPixmap::fromImage(image);
+    const ImageGridPixmapCache::Key key{pending_.take(id), image.size(),
+                                        scaler_->method()};
+    pixmapCache_.insert(key, pm);
+    setTilePixmap(id, pm);
+}
+
+void ImageGridWidget::onTileFailed(const quint64 id, const QSize &size)
+{
+    if(!pending_.contains(id) || targetSizes_.value(id) != size) {
+        return;
+    }
+
+    // Not cached, another tile may decode the same source later
+    pending_.remove(id);
+    QPixmap pm(size);
+    pm.fill(palette().color(QPalette::Dark));
+    QPainter painter(&pm);
+    painter.setPen(palette().color(QPalette::Light));
+    painter.drawLine(0, 0, size.width() - 1, size.height() - 1);
+    painter.drawLine(0, size.height() - 1, size.width() - 1, 0);
+    painter.end();
+    setTilePixmap(id, pm);
+}
+
+int ImageGridWidget::insertImages(const int row, const int column, const QList<QIcon> &icons)
+{
+    if(!canInsertBefore(qMakePair(row, column))) {
+        return 0;
+    }
+
+    QList<QIcon> valid;
+    QList<QSharedPointer<ImageGridSource>> sources;
+    readIcons(icons, &valid, &sources);
+
+    auto batch = new ImageGridBatchCommand(this, tr("Insert images"));
+    const auto inserted = addInserts(batch, row, column, false, valid, sources);
+    pushBatch(batch);
+    return inserted;
+}
+
+int ImageGridWidget::insertImages(const int row, const int column, const QStringList &paths)
+{
+    if(!canInsertBefore(qMakePair(row, column))) {
+        return 0;
+    }
+
+    auto batch = new ImageGridBatchCommand(this, tr("Insert images"));
+    const auto inserted = addInserts(batch, row, column, false, {}, readFiles(paths));
+    pushBatch(batch);
+    return inserted;
+}
+
+int ImageGridWidget::appendRow(const QList<QIcon> &icons)
+{
+    QList<QIcon> valid;
+    QList<QSharedPointer<ImageGridSource>> sources;
+    readIcons(icons, &valid, &sources);
+
+    auto batch = new ImageGridBatchCommand(this, tr("Add row"));
+    const auto inserted = addInserts(batch, grid_.rowCount(), 0, true, valid, sources);
+    pushBatch(batch);
+    return inserted;
+}
+
+int ImageGridWidget::appendRow(const QStringList &paths)
+{
+    auto batch = new ImageGridBatchCommand(this, tr("Add row"));
+    const auto inserted = addInserts(batch, grid_.rowCount(), 0, true, {}, readFiles(paths));
+    pushBatch(batch);
+    return inserted;
+}
+
+int ImageGridWidget::setGrid(const QList<QList<QIcon>> &rows)
+{
+    auto batch = new ImageGridBatchCommand(this, tr("Replace images"));
+    removeAll(batch);
+    auto inserted = 0;
+    auto row = 0;
+    for(const QList<QIcon> &icons : rows) {
+        QList<QIcon> valid;
+        QList<QSharedPointer<ImageGridSource>> sources;
+        readIcons(icons, &valid, &sources);
+        if(!sources.isEmpty()) {
+            inserted += addInserts(batch, row++, 0, true, valid, sources);
+        }
+    }
+
+    pushBatch(batch);
+    return inserted;
+}
+
+int ImageGridWidget::setGrid(const QList<QStringList> &rows)
+{
+    auto batch = new ImageGridBatchCommand(this, tr("Replace images"));
+    removeAll(batch);
+    auto inserted = 0;
+    auto row = 0;
+    for(const QStringList &paths : rows) {
+        const QList<QSharedPointer<ImageGridSource>> sources = readFiles(paths);
+        if(!sources.isEmpty()) {
+            inserted += addInserts(batch, row++, 0, true, {}, sources);
+        }
+    }
+
+    pushBatch(batch);
+    return inserted;
+}
+
+void ImageGridWidget::clear()
+{
+    if(grid_.isEmpty()) {
+        return;
+    }
+
+    undoStack_->push(new ImageGridRemoveTilesCommand(this, indexesOf(0, grid_.rowCount()),
+                                                     tr("Clear")));
+}
+
+int ImageGridWidget::removeRows(const int row, const int count)
+{
+    if(row < 0 || row >= grid_.rowCount()) {
+        qWarning("ImageGridWidget::removeRows: Invalid row: %d", row);
+        return 0;
+    }
+
+    if(count <= 0 || row + count > grid_.rowCount()) {
+        qWarning("ImageGridWidget::removeRows: Invalid count: %d", count);
+        return 0;
+    }
+
+    const auto tiles = grid_.tileCount();
+    undoStack_->push(new ImageGridRemoveTilesCommand(this, indexesOf(row, count),
+                                                     tr("Remove rows")));
+    return tiles - grid_.tileCount();
+}
+
+int ImageGridWidget::removeTiles(const QList<Index> &tiles)
+{
+    QList<Index> valid;
+    for(const Index &index : tiles) {
+        if(!grid_.isValid(index.first, index.second)) {
+            qWarning("ImageGridWidget::removeTiles: Invalid index: %dx%d",
+                     index.first, index.second);
+            continue;
+        }
+
+        valid.append(index);
+    }
+
+    if(valid.isEmpty()) {
+        return 0;
+    }
+
+    const auto count = grid_.tileCount();
+    undoStack_->push(new ImageGridRemoveTilesCommand(this, valid, tr("Remove images")));
+    return count - grid_.tileCount();
+}
+
+bool ImageGridWidget::isSelected(const int row, const int column) const
+{
+    return grid_.isValid(row, column) && selection_.contains(grid_.idAt(row, column));
+}
+
+void ImageGridWidget::setSelected(const int row, const int column, const bool selected)
+{
+    if(!grid_.isValid(row, column)) {
+        qWarning("ImageGridWidget::setSelected: Invalid index: %dx%d", row, column);
+        return;
+    }
+
+    const auto id = grid_.idAt(row, column);
+    if(selection_.contains(id) == selected) {
+        return;
+    }
+
+    if(selected) {
+        selection_.insert(id);
+    }
+    else {
+        selection_.remove(id);
+    }
+
+    update();
+    emit selectionChanged();
+}
+
+QList<ImageGridWidget::Index> ImageGridWidget::selectedTiles() const
+{
+    QList<Index> selected;
+    if(selection_.isEmpty()) {
+        return selected;
+    }
+
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            if(selection_.contains(grid_.idAt(row, col))) {
+                selected.append(qMakePair(row, col));
+            }
+        }
+    }
+
+    return selected;
+}
+
+void ImageGridWidget::clearSelection()
+{
+    if(selection_.isEmpty()) {
+        return;
+    }
+
+    selection_.clear();
+    update();
+    emit selectionChanged();
+}
+
+int ImageGridWidget::removeSelected()
+{
+    return removeTiles(selectedTiles());
+}
+
+void ImageGridWidget::beginUpdate()
+{
+    ++updateDepth_;
+}
+
+void ImageGridWidget::endUpdate()
+{
+    if(updateDepth_ == 0) {
+        qWarning("ImageGridWidget::endUpdate: No matching beginUpdate()");
+        return;
+    }
+
+    if(--updateDepth_ > 0) {
+        return;
+    }
+
+    resizeWidgets();
+    update();
+}
+
+bool ImageGridWidget::isUpdating() const
+{
+    return updateDepth_ > 0;
+}
+
+QUndoStack *ImageGridWidget::undoStack() const
+{
+    return undoStack_;
+}
+
+ImageGridStats &ImageGridWidget::stats()
+{
+    return *stats_;
 }
 
-enum Side {
-    Top, Right, Bottom, Left
-};
+ImageGridPixmapCache &ImageGridWidget::pixmapCache()
+{
+    return pixmapCache_;
+}
 
-Side getWidth(const QPoint &needle, const QPoint &haystack) {
-    const auto midW = haystack.x() / 2;
-    if(needle.x() < midW) {
-        return Left;
-    }
-    else {
-        return Right;
-    }
+ImageGridWidget::RenderMode ImageGridWidget::renderMode() const
+{
+    return renderMode_;
 }
 
-Side getHeight(const QPoint &needle, const QPoint &haystack) {
-    const auto midH = haystack.y() / 2;
-    if(needle.y() < midH) {
-        return Top;
-    }
-    else {
-        return Bottom;
+void ImageGridWidget::setRenderMode(const RenderMode mode)
+{
+    if(mode == renderMode_) {
+        return;
     }
-}
 
+    renderMode_ = mode;
 
-Side getSide(const QPoint &needle, const QPoint &haystack) {
-    const auto x = getWidth(needle, haystack);
-    const auto y = getHeight(needle, haystack);
-    if(x == Left && y == Top) {
-        // top-left
-        const auto diagonalPixelHorizontal = needle.y() * 2;
-        if(needle.x() > diagonalPixelHorizontal) {
-            return Top;
-        }
-        else {
-            return Left;
+    // Tiles keep their pixmaps across the switch so nothing is rescaled
+    const auto rows = grid_.rowCount();
+    if(mode == PaintedRendering) {
+        for(auto row = rows - 1; row >= 0; --row) {
+            removeRowWidgets(row);
         }
+
+        labels_.clear();
     }
-    else if(x == Right && y == Top) {
-        // top-right
-        QPoint tmp(haystack.x() - needle.x(), needle.y());
-        const auto diagonalPixelVertical = tmp.x() / 2;
-        if(tmp.y() < diagonalPixelVertical) {
-            return Top;
-        }
-        else {
-            return Right;
+    else {
+        for(auto row = 0; row < rows; ++row) {
+            insertRowWidgets(row);
         }
     }
-    else if(x == Left && y == Bottom) {
-        // bottom-left
-        QPoint tmp(haystack.x() - needle.x(), needle.y());
-        const auto diagonalPixelVertical = tmp.x() / 2;
-        if(tmp.y() < diagonalPixelVertical) {
-            return Left;
-        }
-        else {
-            return Bottom;
-        }
+
+    updateSizeConstraint();
+    if(followsWidth_) {
+        followWidth();
     }
-    if(x == Right && y == Bottom) {
-        // bottom-right
-        const auto diagonalPixelHorizontal = needle.y() * 2;
-        if(needle.x() > diagonalPixelHorizontal) {
-            return Right;
+
+    // Labels need every pixmap, painted rows only those near the visible area
+    if(virtualized_) {
+        if(mode == PaintedRendering) {
+            trackLiveTiles();
+            updateLiveRows();
         }
         else {
-            return Bottom;
+            liveTiles_.clear();
+            grid_.markAllDirty();
+            resizeWidgets();
         }
     }
-}
 
-} // namespace
+    update();
+}
 
-// TODO: Implement undo
-// TODO: Implement changing spacing
-// TODO: Drag n' drop existing images in the layout
-// so that we don't have to undo the whole thing to reset
-// TODO: Drawing drop helper lines only work with 10px spacing
-// so we need to make it work with more or less pixels as well
+bool ImageGridWidget::keepOriginals() const
+{
+    return keepOriginals_;
+}
 
-ImageGridWidget::ImageGridWidget(QWidget *parent) :
-    ImageGridWidget(0, parent)
+void ImageGridWidget::setKeepOriginals(const bool keep)
 {
+    keepOriginals_ = keep;
 
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            grid_.sourceAt(row, col)->setKeepOriginal(keep);
+        }
+    }
 }
 
-ImageGridWidget::ImageGridWidget(const int spacing, QWidget *parent) :
-    QWidget(parent),
-    point_(),
-    layout_(new QVBoxLayout),
-    isDragging_(false),
-    grid_(),
-    width_(0),
-    pen_(QPen(QBrush(Qt::blue, Qt::SolidPattern), 1)),
-    backgroundColor_(Qt::transparent)
+QSharedPointer<ImageGridDiskCache> ImageGridWidget::diskCache() const
 {
-    layout_->setSpacing(spacing);
-    layout_->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding, QSizePolicy::Expanding));
-
-    setAcceptDrops(true);
-    setLayout(layout_);
-    setMouseTracking(true);
+    return diskCache_;
 }
 
-int ImageGridWidget::getRowCount() const
+void ImageGridWidget::setDiskCache(const QSharedPointer<ImageGridDiskCache> &cache)
 {
-    if(grid_.isEmpty()) {
-        return 0;
+    diskCache_ = cache;
+
+    const auto rows = grid_.rowCount();
+    for(auto row = 0; row < rows; ++row) {
+        const auto cols = grid_.columnCount(row);
+        for(auto col = 0; col < cols; ++col) {
+            grid_.sourceAt(row, col)->setDiskCache(cache);
+        }
     }
+}
 
-    return grid_.lastKey().first + 1;
+ImageGridLayout::Mode ImageGridWidget::layoutMode() const
+{
+    return gridLayout_.mode();
 }
 
-int ImageGridWidget::getColumnCount(const int row) const
+void ImageGridWidget::setLayoutMode(const ImageGridLayout::Mode mode)
 {
-    if(row < 0) {
-        qWarning("ImageGridWidget::getColumnCount: Negative row: %d", row);
-        return 0;
+    if(mode == gridLayout_.mode()) {
+        return;
     }
 
-    const QList<Index> keys = grid_.keys();
-    return std::count_if(keys.cbegin(), keys.cend(),
-                         [&row](const Index &key){ return key.first == row; });
+    gridLayout_.setMode(mode);
+    resizeAll_ = true;
+
+    scheduleResize();
 }
 
-QIcon ImageGridWidget::iconAt(const int row, const int column) const
+int ImageGridWidget::targetRowHeight() const
 {
-    return iconAt(qMakePair(row, column));
+    return targetRowHeight_;
 }
 
-QIcon ImageGridWidget::iconAt(const ImageGridWidget::Index index) const
+void ImageGridWidget::setTargetRowHeight(const int height)
 {
-    if(!grid_.contains(index)) {
-        return {};
+    if(height < 0) {
+        qWarning("ImageGridWidget::setTargetRowHeight: Negative height: %d", height);
+        return;
     }
 
-    return grid_.value(index);
+    targetRowHeight_ = height;
+    resizeAll_ = true;
+
+    scheduleResize();
 }
 
-QMap<int, QSize> ImageGridWidget::calculateRowSizes() const
+bool ImageGridWidget::exportTo(const QString &path, const int width)
 {
-    // 1. Calculate how many columns each row has
-    const QList<Index> keys = grid_.keys();
-    QHash<int, int> counts;
-    for(const Index &key : keys) {
-        counts[key.first]++;
+    if(grid_.isEmpty()) {
+        qWarning("ImageGridWidget::exportTo: Empty grid");
+        return false;
     }
 
-    // 2. Minimum width will be used to calculate the new sizes
-    // for each row where the column size differs
-    const QPixmap pmIcon = grid_.first().pixmap(grid_.first().availableSizes().first());
-    const auto minWidth = width_ > 0 ? width_ : pmIcon.width();
-
-    // 3. Calculate the image widths for each row
-    QMap<int, QSize> sizes;
-    for(auto it = counts.cbegin(); it != counts.cend(); ++it) {
-        const auto numberOfImages = it.value();
-        const auto rowSpacing = (numberOfImages - 1) * layout_->spacing();
-        const auto widthWithoutSpacing = minWidth - rowSpacing;
-        const auto rowImgWidth = widthWithoutSpacing / numberOfImages;
-        sizes.insert(it.key(), QSize(rowImgWidth,
-                                     calculateHeight(pmIcon, rowImgWidth)));
+    if(width <= 0) {
+        qWarning("ImageGridWidget::exportTo: Invalid width: %d", width);
+        return false;
     }
 
-    return sizes;
-}
+    // Make sure the reference size matches the current grid
+    resizeWidgets();
 
-void ImageGridWidget::insertBefore(const int row, const QIcon &icon)
-{
-    if(row < 0) {
-        qWarning("ImageGridWidget::insertBefore: Negative row: %d", row);
-        return;
-    }
+    const auto scale = static_cast<double>(width) / gridLayout_.layoutWidth();
+    ImageGridLayout exportLayout(width, qRound(gridLayout_.spacing() * scale),
+                                 gridLayout_.referenceSize());
+    exportLayout.setMode(gridLayout_.mode());
 
-    if(icon.isNull()) {
-        qWarning("ImageGridWidget::insertBefore: Null icon");
-        return;
+    ImageGridImageWriter writer(path);
+    if(!writer.open(exportLayout.size(grid_))) {
+        qWarning("ImageGridWidget::exportTo: %s", qPrintable(writer.errorString()));
+        return false;
     }
 
-    // Insert icon into the layout
-    auto lo = new QHBoxLayout;
-    const QPixmap pm = icon.pixmap(icon.availableSizes().first());
-    auto label = new QLabel;
-    label->setPixmap(pm);
-    lo->addWidget(label);
-    lo->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding));
-    layout_->insertLayout(row, lo);
-
-    QMap<Index, QIcon> newGrid;
-    // 1. Copy icons above it with their current position
-    auto it = grid_.begin();
-    for(; it != grid_.end(); ++it) {
-        const Index current = it.key();
-        if(current.first < row) {
-            newGrid.insert(qMakePair(current.first, current.second), it.value());
-        }
-        else {
-            break;
+    ImageGridCompositor compositor(backgroundColor_.alpha() == 255 ?
+                                   backgroundColor_ : QColor(Qt::white));
+    compositor.setTransformationMode(scaler_->transformationMode());
+    compositor.setFilter(scaler_->filter());
+    // Every band keeps the threads busy, bands are encoded in order
+    const auto rows = grid_.rowCount();
+    const auto bandRows = compositor.threadCount();
+    for(auto row = 0; row < rows; row += bandRows) {
+        const QImage band = compositor.composeRows(grid_, exportLayout, row,
+                                                   qMin(bandRows, rows - row));
+        if(!writer.write(band)) {
+            qWarning("ImageGridWidget::exportTo: %s", qPrintable(writer.errorString()));
+            return false;
         }
     }
 
-    // 2. Copy icons below it with their position moved down by one row
-    for(; it != grid_.end(); ++it) {
-        const Index current = it.key();
-        newGrid.insert(qMakePair(current.first + 1, current.second), it.value());
+    if(!writer.close()) {
+        qWarning("ImageGridWidget::exportTo: %s", qPrintable(writer.errorString()));
+        return false;
     }
 
-    // 3. Insert the new icon where there's an empty row now
-    newGrid.insert(qMakePair(row, 0), icon);
-    grid_.swap(newGrid);
+    return true;
+}
 
+bool ImageGridWidget::saveProject(const QString &path)
+{
+    // Make sure the thumbnail sizes match the current grid
     resizeWidgets();
+
+    // Placeholders of tiles still being scaled and quick previews waiting
+    // for refineTiles() are not saved, those tiles are scaled from their source
+    QHash<quint64, QPixmap> finished = pixmaps_;
+    for(auto it = pending_.cbegin(); it != pending_.cend(); ++it) {
+        finished.remove(it.key());
+    }
+
+    for(auto it = previews_.cbegin(); it != previews_.cend(); ++it) {
+        finished.remove(it.key());
+    }
+
+    const ImageGridProjectFile::Settings settings{layout_->spacing(), gridLayout_.width(),
+                                                  pen_, backgroundColor_,
+                                                  gridLayout_.mode(), targetRowHeight_};
+    ImageGridProjectFile file(path);
+    if(!file.write(grid_, gridLayout_, settings, finished)) {
+        qWarning("ImageGridWidget::saveProject: %s", qPrintable(file.errorString()));
+        return false;
+    }
+
+    return true;
 }
 
-void ImageGridWidget::insertBefore(const Index index, const QIcon &icon)
+bool ImageGridWidget::loadProject(const QString &path)
 {
-    if(index.first < 0 || index.second < 0) {
-        qWarning("ImageGridWidget::insertBefore: Negative index: %dx%d",
-                 index.first, index.second);
-        return;
+    ImageGridProjectFile file(path);
+    ImageGridProjectFile::Settings settings;
+    ImageGridProjectFile::Rows rows;
+    if(!file.read(&settings, &rows)) {
+        qWarning("ImageGridWidget::loadProject: %s", qPrintable(file.errorString()));
+        return false;
     }
 
-    if(icon.isNull()) {
-        qWarning("ImageGridWidget::insertBefore: Null icon");
-        return;
+    // Commands refer to tiles of the old grid
+    undoStack_->clear();
+
+    beginUpdate();
+    QSet<quint64> ids;
+    for(const Index &index : indexesOf(0, grid_.rowCount())) {
+        ids.insert(grid_.idAt(index.first, index.second));
     }
 
-    QMap<Index, QIcon> newGrid;
-    for(auto it = grid_.begin(); it != grid_.end(); ++it) {
-        const Index current = it.key();
-        if(current.first != index.first) {
-            newGrid.insert(current, it.value());
-        }
-        else {
-            if(current.second < index.second) {
-                newGrid.insert(current, it.value());
-            }
-            else {
-                newGrid.insert(qMakePair(current.first, current.second + 1), it.value());
-            }
+    removeIds(ids);
+
+    setSpacing(settings.spacing);
+    setWidth(settings.width);
+    setPen(settings.pen);
+    setBackgroundColor(settings.backgroundColor);
+    setLayoutMode(settings.layoutMode);
+    setTargetRowHeight(settings.targetRowHeight);
+
+    for(auto row = 0; row < rows.size(); ++row) {
+        const QVector<QSharedPointer<ImageGridSource>> &sources = rows.at(row);
+        insertBefore(row, sources.first());
+        for(auto col = 1; col < sources.size(); ++col) {
+            insertBefore(qMakePair(row, col), sources.at(col));
         }
     }
 
-    newGrid.insert(index, icon);
-    grid_.swap(newGrid);
+    endUpdate();
+    return true;
+}
 
-    // Insert icon into the layout
-    const QPixmap pm = icon.pixmap(icon.availableSizes().first());
-    auto label = new QLabel;
-    label->setPixmap(pm);
-    auto lo = qobject_cast<QHBoxLayout *>(layout_->itemAt(index.first)->layout());
-    lo->insertWidget(index.second, label);
+QSize ImageGridWidget::sizeHint() const
+{
+    if(renderMode_ == LabelRendering) {
+        return QWidget::sizeHint();
+    }
 
-    resizeWidgets();
+    return QSize(geometry_.width(), geometry_.height());
 }
 
-void ImageGridWidget::resizeWidgets()
+QSize ImageGridWidget::minimumSizeHint() const
 {
-    if(grid_.isEmpty()) {
+    const QSize hint = renderMode_ == LabelRendering ? QWidget::minimumSizeHint() : sizeHint();
+
+    // The grid narrows down to any width it is given
+    return followsWidth_ ? QSize(0, hint.height()) : hint;
+}
+
+bool ImageGridWidget::isProgressive() const
+{
+    return progressive_;
+}
+
+void ImageGridWidget::setProgressive(const bool progressive)
+{
+    progressive_ = progressive;
+
+    // Previews left over are not refined by anything else
+    if(!progressive) {
+        refineTimer_->stop();
+        refineTiles();
+    }
+}
+
+int ImageGridWidget::refineDelay() const
+{
+    return refineTimer_->interval();
+}
+
+void ImageGridWidget::setRefineDelay(const int msec)
+{
+    if(msec < 0) {
+        qWarning("ImageGridWidget::setRefineDelay: Negative delay: %d", msec);
         return;
     }
 
-    const auto minWidth = width_ > 0 ? width_ :
-        grid_.first().pixmap(grid_.first().availableSizes().first()).width();
+    refineTimer_->setInterval(msec);
+}
 
-    const auto spacing = layout_->spacing();
-    const QMap<int, QSize> sizes = calculateRowSizes();
-    for(auto it = sizes.cbegin(); it != sizes.cend(); ++it) {
-        const auto row = it.key();
-        auto lo = qobject_cast<QHBoxLayout *>(layout_->itemAt(row)->layout());
-        // count() - 1 skips the spacer item
-        const auto count = lo->count() - 1;
-        for(auto idx = 0; idx < count; ++idx) {
-            QSize size = it.value();
-            if(idx + 1 == count) {
-                // If last widget, resize width to fill the minimum width
-                const auto pixelsTaken = ((idx + 1) * size.width()) + (idx * spacing);
-                const auto extraPixels = minWidth - pixelsTaken;
-                size.setWidth(size.width() + extraPixels);
-            }
+bool ImageGridWidget::followsWidth() const
+{
+    return followsWidth_;
+}
 
-            const QPixmap pm = grid_.value(qMakePair(row, idx)).pixmap(size).scaled(size);
-            qobject_cast<QLabel *>(lo->itemAt(idx)->widget())->setPixmap(pm);
-        }
+void ImageGridWidget::setFollowsWidth(const bool follow)
+{
+    if(follow == followsWidth_) {
+        return;
+    }
+
+    followsWidth_ = follow;
+    updateSizeConstraint();
+    if(follow) {
+        followWidth();
     }
 }
 
-void ImageGridWidget::removeAt(const ImageGridWidget::Index index)
+bool ImageGridWidget::isVirtualized() const
 {
-    const auto cols = getColumnCount(index.first);
-    grid_.remove(index);
-    for(auto c = index.second + 1; c < cols; ++c) {
-        const QIcon icon = grid_.take(qMakePair(index.first, c));
-        grid_.insert(qMakePair(index.first, c - 1), icon);
-    }
+    return virtualized_;
 }
 
-void ImageGridWidget::removeAt(const int row)
+void ImageGridWidget::setVirtualized(const bool virtualized)
 {
-    // Remove everything from row row
-    const auto cols = getColumnCount(row);
-    for(auto idx = 0; idx < cols; ++idx) {
-        grid_.remove(qMakePair(row, idx));
+    if(virtualized == virtualized_) {
+        return;
     }
 
-    // Then move the other rows down by one
-    const auto rows = getRowCount();
-    for(auto r = row; r < rows; ++r) {
-        const auto cols = getColumnCount(r);
-        for(auto c = 0; c < cols; ++c) {
-            const QIcon icon = grid_.take(qMakePair(r, c));
-            grid_.insert(qMakePair(r - 1, c), icon);
-        }
+    virtualized_ = virtualized;
+    if(renderMode_ != PaintedRendering) {
+        return;
+    }
+
+    if(virtualized) {
+        trackLiveTiles();
+        updateLiveRows();
+    }
+    else {
+        // Every row gets its pixmaps back
+        liveTiles_.clear();
+        grid_.markAllDirty();
+        resizeWidgets();
     }
 }
 
@@ -375,8 +1900,10 @@ void ImageGridWidget::setSpacing(const int spacing)
     }
 
     layout_->setSpacing(spacing);
+    gridLayout_.setSpacing(spacing);
+    resizeAll_ = true;
 
-    resizeWidgets();
+    scheduleResize();
 }
 
 void ImageGridWidget::setWidth(const int width)
@@ -386,9 +1913,10 @@ void ImageGridWidget::setWidth(const int width)
         return;
     }
 
-    width_ = width;
+    gridLayout_.setWidth(width);
+    resizeAll_ = true;
 
-    resizeWidgets();
+    scheduleResize();
 }
 
 void ImageGridWidget::setPen(const QPen &pen)
@@ -400,7 +1928,35 @@ void ImageGridWidget::setBackgroundColor(const QColor &color)
 {
     backgroundColor_ = color;
 
-    repaint();
+    update();
+}
+
+void ImageGridWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+
+    if(followsWidth_ && event->size().width() != event->oldSize().width()) {
+        followWidth();
+    }
+
+    // The visible area may have grown
+    updateLiveRows();
+}
+
+void ImageGridWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    // Scrolling moves the widget or one of its parents inside the viewport
+    for(QWidget *parent = parentWidget(); parent; parent = parent->parentWidget()) {
+        if(auto area = qobject_cast<QAbstractScrollArea *>(parent)) {
+            connect(area->verticalScrollBar(), &QScrollBar::valueChanged,
+                    this, &ImageGridWidget::updateLiveRows, Qt::UniqueConnection);
+            break;
+        }
+    }
+
+    updateLiveRows();
 }
 
 void ImageGridWidget::dragEnterEvent(QDragEnterEvent *event)
@@ -416,14 +1972,20 @@ void ImageGridWidget::dragLeaveEvent(QDragLeaveEvent *event)
 
     isDragging_ = false;
 
-    repaint();
+    setIndicator(QLine());
 }
 
 void ImageGridWidget::dragMoveEvent(QDragMoveEvent *event)
 {
     point_ = event->pos();
 
-    repaint();
+    QLine line;
+    {
+        ImageGridTimer timer(*stats_, ImageGridStats::HitTestPhase);
+        line = calculateIndicator();
+    }
+
+    setIndicator(line);
 }
 
 void ImageGridWidget::dropEvent(QDropEvent *event)
@@ -431,149 +1993,142 @@ void ImageGridWidget::dropEvent(QDropEvent *event)
     event->accept();
 
     isDragging_ = false;
+    setIndicator(QLine());
 
-    const auto list = qobject_cast<QListWidget *>(event->source());
-    const auto icon = qvariant_cast<QIcon>(list->currentItem()->data(Qt::DecorationRole));
-
-    // Decide where to put the widget...
-    if(layout_->isEmpty()) {
-        insertBefore(0, icon);
+    // Tiles and rows dragged inside the grid keep their pixmaps
+    if(event->source() == this && event->mimeData()->hasFormat(TileMimeType)) {
+        dropMove(event);
+        update();
         return;
     }
 
-    const auto spacing = layout_->spacing();
-
-    const QPair<int, int> v = getVertical();
-    auto y = v.first;
-    const auto idx = v.second;
-    if(point_.y() > y) {
-        insertBefore(idx, icon);
-        repaint();
+    const auto list = qobject_cast<QListWidget *>(event->source());
+    if(!list || !list->currentItem()) {
         return;
     }
 
-    const auto layoutSize = layout_->itemAt(idx)->sizeHint();
-    const auto height = layoutSize.height() + spacing;
-    // Point relative to the current image
-    auto adjusted = point_;
-    adjusted -= QPoint(0, idx == 0 ? 0 : y - height);
+    const QListWidgetItem *item = list->currentItem();
 
-    const QPair<int, int> h = getHorizontal(idx);
-    auto x = h.first;
-    const auto xIdx = h.second;
-    if(point_.x() > x) {
-        insertBefore(qMakePair(idx, xIdx), icon);
-        repaint();
-        return;
+    // Items with a file path are decoded at tile size instead of using the icon
+    const QString path = item->data(Qt::UserRole).toString();
+    const ImageGridLayout::DropTarget target = ImageGridLayout::dropTarget(geometry_, point_);
+    if(!path.isEmpty()) {
+        if(target.newRow) {
+            insertImage(target.row, path);
+        }
+        else {
+            insertImage(target.row, target.column, path);
+        }
+    }
+    else {
+        const auto icon = qvariant_cast<QIcon>(item->data(Qt::DecorationRole));
+        const QSharedPointer<ImageGridSource> source = ImageGridSource::fromIcon(icon);
+        if(source) {
+            undoStack_->push(new ImageGridInsertCommand(this, target.row, target.column,
+                                                        target.newRow, icon, source));
+        }
     }
 
-    // Get image size for current image
-    const QSize imageSize = layout_->itemAt(idx)->layout()->itemAt(xIdx)->sizeHint();
-    const auto width = imageSize.width() + spacing;
-
-    adjusted -= QPoint(xIdx == 0 ? 0 : x - width, 0);
+    update();
+}
 
-    const auto side = getSide(adjusted, QPoint(imageSize.width(), imageSize.height()));
-    if(side == Top) {
-        insertBefore(idx, icon);
-    }
-    else if(side == Bottom) {
-        insertBefore(idx + 1, icon);
-    }
-    else if(side == Left) {
-        insertBefore(qMakePair(idx, xIdx), icon);
-    }
-    else if(side == Right) {
-        insertBefore(qMakePair(idx, xIdx + 1), icon);
+void ImageGridWidget::keyPressEvent(QKeyEvent *event)
+{
+    if(event->key() != Qt::Key_Delete || selection_.isEmpty()) {
+        QWidget::keyPressEvent(event);
+        return;
     }
 
-    repaint();
+    removeSelected();
 }
 
 void ImageGridWidget::mousePressEvent(QMouseEvent *event)
 {
-    const auto rowCount = layout_->count() - 1;
-    if(rowCount == 0) {
+    pressIndex_ = qMakePair(-1, -1);
+    if(event->button() != Qt::LeftButton || geometry_.rowCount() == 0) {
         return;
     }
 
+    ImageGridTimer timer(*stats_, ImageGridStats::HitTestPhase);
     const QPoint pos = event->pos();
-    QLayoutItem *li = nullptr;
-    auto height = 0;
-    auto yIdx = 0;
-    for(; yIdx < rowCount; ++yIdx) {
-        li = layout_->itemAt(yIdx);
-        height += li->sizeHint().height() + layout_->spacing();
-        if(pos.y() <= height) {
-            break;
-        }
-    }
-
-    if(pos.y() > height) {
+    const auto yIdx = geometry_.vertical(pos.y()).second;
+    if(yIdx == geometry_.rowCount()) {
         // We don't want to remove the last widget
         // if the mouse press happens below it
         return;
     }
 
-    auto width = 0;
-    QLayoutItem *li2 = nullptr;
-    QHBoxLayout *lo = qobject_cast<QHBoxLayout*>(li->layout());
-    const auto colCount = lo->count() - 1;
-    auto xIdx = 0;
-    for(; xIdx < colCount; ++xIdx) {
-        li2 = lo->itemAt(xIdx);
-        width += li2->sizeHint().width() + lo->spacing();
-        if(pos.x() <= width) {
-            break;
-        }
+    const auto xIdx = geometry_.horizontal(yIdx, pos.x()).second;
+    if(xIdx == geometry_.columnCount(yIdx)) {
+        return;
     }
 
-    if(pos.x() > width) {
+    // Released without dragging removes the tile, see mouseReleaseEvent()
+    pressIndex_ = qMakePair(yIdx, xIdx);
+    pressPos_ = pos;
+}
+
+void ImageGridWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if(!(event->buttons() & Qt::LeftButton) || pressIndex_.first < 0) {
         return;
     }
 
-    if(lo && colCount == 1) {
-        // Remove widget and spacer item
-        for(auto idx = 0; idx < lo->count(); ++idx) {
-            lo->itemAt(idx)->widget()->deleteLater();
-            lo->removeItem(lo->itemAt(idx));
-        }
+    if((event->pos() - pressPos_).manhattanLength() < QApplication::startDragDistance()) {
+        return;
+    }
 
-        // Then remove the layout
-        layout_->removeItem(lo);
-        lo->deleteLater();
+    startDrag(event->modifiers());
+}
 
-        removeAt(yIdx);
+void ImageGridWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() != Qt::LeftButton || pressIndex_.first < 0) {
+        return;
     }
-    else if(lo) {
-        li2->widget()->deleteLater();
-        lo->removeItem(li2);
 
-        removeAt(qMakePair(yIdx, xIdx));
+    const Index index = pressIndex_;
+    pressIndex_ = qMakePair(-1, -1);
+    if(event->modifiers() & Qt::ControlModifier) {
+        setSelected(index.first, index.second, !isSelected(index.first, index.second));
+        return;
     }
 
-    resizeWidgets();
+    undoStack_->push(new ImageGridRemoveCommand(this, index.first, index.second));
 }
 
 void ImageGridWidget::paintEvent(QPaintEvent *event)
 {
+    ImageGridTimer timer(*stats_, ImageGridStats::PaintPhase);
     QWidget::paintEvent(event);
 
     QPainter painter(this);
-    if(!layout_->isEmpty() && layout_->spacing() > 0
+    if(!grid_.isEmpty() && layout_->spacing() > 0
             && backgroundColor_ != Qt::transparent) {
-        painter.setBrush(QBrush(backgroundColor_));
-        painter.drawRect(QRect(0, 0, width(), height()));
+        painter.fillRect(event->rect(), backgroundColor_);
+    }
+
+    if(renderMode_ == PaintedRendering) {
+        timer.setTiles(paintTiles(painter, event->rect()));
+    }
+
+    if(!selection_.isEmpty()) {
+        paintSelection(painter, event->rect());
     }
 
-    if(!isDragging_) {
+    if(!isDragging_ || indicator_.isNull()
+            || !event->rect().intersects(indicatorRect(indicator_))) {
         return;
     }
 
     painter.setPen(pen_);
-    if(layout_->isEmpty()) {
-        painter.drawLine(0, 0, width(), 0);
-        return;
+    painter.drawLine(indicator_);
+}
+
+QLine ImageGridWidget::calculateIndicator() const
+{
+    if(grid_.isEmpty()) {
+        return QLine(0, 0, width(), 0);
     }
 
     const auto spacing = layout_->spacing();
@@ -584,23 +2139,24 @@ void ImageGridWidget::paintEvent(QPaintEvent *event)
     const auto idx = v.second;
     if(point_.y() > y) {
         y--;
-        painter.drawLine(spacing - 1, y + halfSpacing,
-                         layout_->sizeHint().width() - spacing, y + halfSpacing);
-        return;
+        return QLine(spacing - 1, y + halfSpacing,
+                     geometry_.width() - spacing, y + halfSpacing);
     }
 
-    const auto layoutSize = layout_->itemAt(idx)->sizeHint();
-    const auto height = layoutSize.height() + spacing;
+    const auto height = geometry_.rowHeight(idx) + spacing;
     // Point relative to the current image
     auto adjusted = point_;
     adjusted -= QPoint(0, idx == 0 ? 0 : y - height);
 
     const QPair<int, int> h = getHorizontal(idx);
     auto x = h.first;
-    const auto xIdx = h.second;
+    const auto colCount = geometry_.columnCount(idx);
+    // Past the last image the drop appends to the row
+    const auto pastEnd = h.second == colCount;
+    const auto xIdx = pastEnd ? colCount - 1 : h.second;
 
     // Get image size for current image
-    const QSize imageSize = layout_->itemAt(idx)->layout()->itemAt(xIdx)->sizeHint();
+    const QSize imageSize(geometry_.columnWidth(idx, xIdx), geometry_.rowHeight(idx));
     const auto width = imageSize.width() + spacing;
 
     adjusted -= QPoint(xIdx == 0 ? 0 : x - width, 0);
@@ -608,40 +2164,47 @@ void ImageGridWidget::paintEvent(QPaintEvent *event)
     x--;
     y--;
 
-    const auto side = getSide(adjusted, QPoint(imageSize.width(), imageSize.height()));
-    if(side == Top) {
-        painter.drawLine(x - width + spacing, y - height + halfSpacing, x, y - height + halfSpacing);
+    const auto side = pastEnd ? ImageGridLayout::Right :
+        ImageGridLayout::side(adjusted, imageSize);
+    if(side == ImageGridLayout::Top) {
+        return QLine(x - width + spacing, y - height + halfSpacing, x, y - height + halfSpacing);
     }
-    else if(side == Bottom) {
-        painter.drawLine(x - width + spacing, y + halfSpacing, x, y + halfSpacing);
+    else if(side == ImageGridLayout::Bottom) {
+        return QLine(x - width + spacing, y + halfSpacing, x, y + halfSpacing);
     }
-    else if(side == Left) {
-        painter.drawLine(x - width + halfSpacing, y - height + spacing, x - width + halfSpacing, y);
+    else if(side == ImageGridLayout::Left) {
+        return QLine(x - width + halfSpacing, y - height + spacing, x - width + halfSpacing, y);
     }
-    else if(side == Right) {
-        painter.drawLine(x + halfSpacing, y - height + spacing, x + halfSpacing, y);
+
+    return QLine(x + halfSpacing, y - height + spacing, x + halfSpacing, y);
+}
+
+QRect ImageGridWidget::indicatorRect(const QLine &line) const
+{
+    if(line.isNull()) {
+        return {};
     }
+
+    // Leave room for the pen width and antialiasing
+    const auto margin = qCeil(pen_.widthF()) + 1;
+    return QRect(line.p1(), line.p2()).normalized()
+            .adjusted(-margin, -margin, margin, margin);
 }
 
-QPair<int, int> ImageGridWidget::getVertical() const
+void ImageGridWidget::setIndicator(const QLine &line)
 {
-    auto y = 0;
-    auto idx = 0;
-    const auto spacing = layout_->spacing();
-    // count() - 1 skips the QSpacerItem
-    for(; idx != layout_->count() - 1; ++idx) {
-        const auto layoutSize = layout_->itemAt(idx)->sizeHint();
-        const auto height = layoutSize.height() + spacing;
-        y += height;
-        if(point_.y() > y) {
-            continue;
-        }
-        else {
-            break;
-        }
+    if(line == indicator_) {
+        return;
     }
 
-    return qMakePair(y, idx);
+    update(indicatorRect(indicator_));
+    update(indicatorRect(line));
+    indicator_ = line;
+}
+
+QPair<int, int> ImageGridWidget::getVertical() const
+{
+    return geometry_.vertical(point_.y());
 }
 
 QPair<int, int> ImageGridWidget::getHorizontal(const int yIndex) const
@@ -651,22 +2214,5 @@ QPair<int, int> ImageGridWidget::getHorizontal(const int yIndex) const
         return {};
     }
 
-    const QLayout *layout = layout_->itemAt(yIndex)->layout();
-    const auto spacing = layout_->spacing();
-    auto x = 0;
-    auto xIdx = 0;
-    auto width = 0;
-    for(; xIdx < layout->count() - 1; ++xIdx) {
-        const QSize imageArea = layout->itemAt(xIdx)->sizeHint();
-        width = imageArea.width() + spacing;
-        x += width;
-        if(point_.x() > x) {
-            continue;
-        }
-        else {
-            break;
-        }
-    }
-
-    return qMakePair(x, xIdx);
+    return geometry_.horizontal(yIndex, point_.x());
 }
@@ -26,26 +26,76 @@ THE SOFTWARE.
 #define IMAGEGRIDWIDGET_HPP
 
 #include <QColor>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QIcon>
-#include <QMap>
+#include <QImage>
+#include <QLine>
+#include <QList>
 #include <QPair>
 #include <QPen>
 #include <QPoint>
+#include <QSet>
+#include <QSharedPointer>
 #include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
 #include <QWidget>
+#include "imagegridgeometry.hpp"
+#include "imagegridlayout.hpp"
+#include "imagegridmodel.hpp"
+#include "imagegridpixmapcache.hpp"
+#include "imagegridsource.hpp"
 
 class QDragEnterEvent;
 class QDragLeaveEvent;
 class QDragMoveEvent;
 class QDropEvent;
+class QIODevice;
+class QKeyEvent;
+class QLabel;
 class QMouseEvent;
+class QPainter;
 class QPaintEvent;
+class QResizeEvent;
+class QShowEvent;
+class QTimer;
+class QUndoCommand;
+class QUndoStack;
 class QVBoxLayout;
+class ImageGridDiskCache;
+class ImageGridScaler;
+class ImageGridStats;
+class ImageGridWidgetBenchmark;
 
 class ImageGridWidget : public QWidget
 {
     Q_OBJECT
 
+    //! Benchmarks drive the private insert, remove and hit-test functions
+    friend class ImageGridWidgetBenchmark;
+
+    //! Undo commands insert and remove tiles through the private functions
+    friend class ImageGridInsertCommand;
+    friend class ImageGridRemoveCommand;
+    friend class ImageGridRemoveTilesCommand;
+    friend class ImageGridMoveCommand;
+    friend class ImageGridMoveRowCommand;
+    friend class ImageGridBatchCommand;
+
+public:
+    //! How tiles are drawn
+    enum RenderMode {
+        //! Every tile is a QLabel in a per-row QHBoxLayout
+        LabelRendering,
+
+        //! Tiles are drawn directly in paintEvent()
+        PaintedRendering
+    };
+
+private:
+
     //! Keeps track of the cursor position when drag 'n dropping
     QPoint point_;
 
@@ -55,14 +105,104 @@ class ImageGridWidget : public QWidget
     //! If dragging
     bool isDragging_;
 
+    //! Drop indicator line for the current cursor position
+    QLine indicator_;
+
     //! Represents a position in the grid
     using Index = QPair<int, int>;
 
+    //! Tile under the last mouse press, (-1, -1) once dragged or released
+    Index pressIndex_;
+
+    //! Position of the last mouse press
+    QPoint pressPos_;
+
     //! Grid will be used to calculate the row sizes
-    QMap<Index, QIcon> grid_;
+    ImageGridModel grid_;
+
+    //! Tile geometry of the grid, rebuilt when the widgets are resized
+    ImageGridGeometry geometry_;
+
+    //! Row and tile size calculations
+    ImageGridLayout gridLayout_;
+
+    //! Cache key of the image the row sizes were last calculated from
+    qint64 referenceKey_;
+
+    //! If every row must be resized, not only the dirty ones
+    bool resizeAll_;
+
+    //! If tiles were inserted, removed or moved since the rows were arranged
+    bool rearrange_;
+
+    //! Scales images off the GUI thread
+    ImageGridScaler *scaler_;
+
+    //! How tiles are drawn
+    RenderMode renderMode_;
+
+    //! Row height to arrange tiles around, 0 keeps the rows as dropped
+    int targetRowHeight_;
+
+    //! If tile sources keep their largest image once mip levels exist
+    bool keepOriginals_;
+
+    //! Thumbnail cache shared by the tile sources, may be null
+    QSharedPointer<ImageGridDiskCache> diskCache_;
+
+    //! Number of beginUpdate() calls without a matching endUpdate()
+    int updateDepth_;
+
+    //! Label of each tile by tile id when using LabelRendering
+    QHash<quint64, QLabel *> labels_;
+
+    //! Current pixmap (scaled image or placeholder) of each tile by tile id
+    QHash<quint64, QPixmap> pixmaps_;
+
+    //! Size each tile was last scaled or queued to be scaled to
+    QHash<quint64, QSize> targetSizes_;
 
-    //! Layout width
-    int width_;
+    //! Icon cache key of each tile waiting for a scaled image by tile id
+    QHash<quint64, qint64> pending_;
+
+    //! Recently scaled pixmaps
+    ImageGridPixmapCache pixmapCache_;
+
+    //! Inserts and removals that can be undone
+    QUndoStack *undoStack_;
+
+    //! Timing of the insert, remove, resize, scale, hit-test and paint phases
+    QSharedPointer<ImageGridStats> stats_;
+
+    //! Runs the relayout scheduled by property changes and resizes
+    QTimer *relayoutTimer_;
+
+    //! Time since the last relayout
+    QElapsedTimer lastResize_;
+
+    //! If the layout width follows the widget width
+    bool followsWidth_;
+
+    //! If tiles show a quick preview until the layout stops changing
+    bool progressive_;
+
+    //! Starts refineTiles() once the layout has stopped changing
+    QTimer *refineTimer_;
+
+    //! Source of each tile showing a preview by tile id
+    QHash<quint64, QSharedPointer<ImageGridSource>> previews_;
+
+    //! Ids of the selected tiles
+    QSet<quint64> selection_;
+
+    //! If only rows near the visible area have pixmaps in PaintedRendering
+    bool virtualized_;
+
+    //! Top of the visible area when live rows were last updated
+    int lastVisibleTop_;
+
+    //! Source of each tile on a virtual row that has a pixmap by tile id
+    QHash<quint64, QSharedPointer<ImageGridSource>> liveTiles_;
 
     //! Pen for drawing helper lines
     QPen pen_;
@@ -85,10 +225,172 @@ class ImageGridWidget : public QWidget
     void insertBefore(Index index, const QIcon &icon);
 
     /**
-     * @brief Calculate row sizes
-     * @return New row sizes
+     * @brief Insert image source as a new row before row
+     * @param row Row to insert before
+     * @param source Image source to add
+     * @param icon Icon the source was made from, may be null
+     */
+    void insertBefore(int row, const QSharedPointer<ImageGridSource> &source,
+                      const QIcon &icon = QIcon());
+
+    /**
+     * @brief Insert image source into an existing row before index
+     * @param index Index to insert before
+     * @param source Image source to add
+     * @param icon Icon the source was made from, may be null
      */
-    QMap<int, QSize> calculateRowSizes() const;
+    void insertBefore(Index index, const QSharedPointer<ImageGridSource> &source,
+                      const QIcon &icon = QIcon());
+
+    /**
+     * @brief Insert a tile as a new row or into an existing row
+     *
+     * Used by undo commands. Arranged rows change after every edit so
+     * position is used instead of row and column when there is a target
+     * row height
+     * @param row Row to insert into, or before if newRow is true
+     * @param column Column to insert before, ignored if newRow is true
+     * @param newRow If the tile is inserted as a new row
+     * @param position Number of tiles before the new one in the whole grid
+     * @param icon Icon the source was made from, may be null
+     * @param source Image source to add
+     * @param id Id the tile had before it was removed, 0 for a new tile
+     * @return Id of the tile or 0 if nothing was inserted
+     */
+    quint64 insertTile(int row, int column, bool newRow, int position, const QIcon &icon,
+                       const QSharedPointer<ImageGridSource> &source, quint64 id);
+
+    /**
+     * @brief Remove a tile and lay out the grid again
+     *
+     * Used by undo commands. Removes the row if it was the last tile on it
+     * @param id Id of the tile
+     * @param hint Index the tile is expected at
+     */
+    void removeTile(quint64 id, Index hint);
+
+    /**
+     * @brief Move a tile, keeping its label and pixmap
+     *
+     * Used by undo commands. Only the rows it leaves and enters are
+     * laid out again
+     * @param from Index of the tile
+     * @param to Index to move to as if the tile had already been removed
+     * @param newRow If the tile becomes a row of its own
+     */
+    void moveTile(Index from, Index to, bool newRow);
+
+    /**
+     * @brief Move a whole row, keeping its labels and pixmaps
+     *
+     * Used by undo commands
+     * @param row Row to move
+     * @param toRow Row to move before as if the row had already been removed
+     */
+    void moveRow(int row, int toRow);
+
+    /**
+     * @brief Drag the pressed tile, or its whole row with Shift held
+     * @param modifiers Keyboard modifiers of the mouse event
+     */
+    void startDrag(Qt::KeyboardModifiers modifiers);
+
+    /**
+     * @brief Move the dragged tile or row to the drop position
+     * @param event Drop event carrying a tile or row from this widget
+     */
+    void dropMove(QDropEvent *event);
+
+    /**
+     * @brief Find a tile by id
+     * @param id Id of the tile
+     * @param hint Index checked before searching the whole grid
+     * @return Index of the tile or (-1, -1) if there is no such tile
+     */
+    Index indexOf(quint64 id, Index hint) const;
+
+    /**
+     * @brief Get the number of tiles before an index in the whole grid
+     * @param index Index, may be one past the last column of a row
+     * @return Position
+     */
+    int positionOf(Index index) const;
+
+    /**
+     * @brief Get the index a tile inserted at a position would have
+     * @param position Number of tiles before the index in the whole grid
+     * @return Index, or (getRowCount(), 0) if it has to start a new row
+     */
+    Index indexAt(int position) const;
+
+    /**
+     * @brief Add commands inserting tiles next to each other to a batch
+     * @param batch Batch to add the commands to
+     * @param row Row to insert into, or before if newRow is true
+     * @param column Column to insert the first tile before
+     * @param newRow If the first tile starts a new row
+     * @param icons Icon of each source, may be shorter than sources
+     * @param sources Image sources to add
+     * @return Number of tiles the batch inserts
+     */
+    int addInserts(QUndoCommand *batch, int row, int column, bool newRow,
+                   const QList<QIcon> &icons,
+                   const QList<QSharedPointer<ImageGridSource>> &sources);
+
+    /**
+     * @brief Add a command removing every tile to a batch
+     * @param batch Batch to add the command to
+     */
+    void removeAll(QUndoCommand *batch);
+
+    /**
+     * @brief Get the index of every tile on a range of rows
+     * @param row First row
+     * @param count Number of rows
+     * @return Indexes in reading order
+     */
+    QList<Index> indexesOf(int row, int count) const;
+
+    /**
+     * @brief Remove many tiles with a single pass over the grid
+     *
+     * Widgets of the affected rows are deleted at once instead of one
+     * deleteLater() per label, and the grid is laid out once
+     * @param ids Ids of the tiles to remove
+     */
+    void removeIds(const QSet<quint64> &ids);
+
+    /**
+     * @brief Push a batch to the undo stack, or delete it if it's empty
+     * @param batch Batch to push
+     */
+    void pushBatch(QUndoCommand *batch);
+
+    /**
+     * @brief Check if a new row can be inserted before row
+     * @param row Row to insert before
+     * @return True if valid
+     */
+    bool canInsertBefore(int row) const;
+
+    /**
+     * @brief Check if an image can be inserted before index
+     * @param index Index to insert before
+     * @return True if valid
+     */
+    bool canInsertBefore(Index index) const;
+
+    /**
+     * @brief Create widgets and geometry for a row inserted into the model
+     * @param row Inserted row
+     */
+    void rowInserted(int row);
+
+    /**
+     * @brief Create the widget for a tile inserted into the model
+     * @param index Inserted index
+     */
+    void tileInserted(Index index);
 
     /**
      * @brief Get vertical data (height, index) for current cursor position
@@ -103,11 +405,146 @@ class ImageGridWidget : public QWidget
      */
     QPair<int, int> getHorizontal(int yIndex) const;
 
+    /**
+     * @brief Calculate the drop indicator line for current cursor position
+     * @return Line in widget coordinates
+     */
+    QLine calculateIndicator() const;
+
+    /**
+     * @brief Get the area covered by a drop indicator line
+     * @param line Indicator line
+     * @return Area to repaint, null rect for a null line
+     */
+    QRect indicatorRect(const QLine &line) const;
+
+    /**
+     * @brief Move the drop indicator, repainting only the old and new line
+     * @param line New indicator line, a null line hides the indicator
+     */
+    void setIndicator(const QLine &line);
+
     /**
      * @brief Resize widgets
+     *
+     * Only rows marked dirty in the model are resized unless spacing,
+     * width or the first image changed since the last call
      */
     void resizeWidgets();
 
+    /**
+     * @brief Schedule a single relayout for all changes until it runs
+     *
+     * The relayout runs on the next event loop turn, but no sooner than
+     * one frame after the previous one
+     */
+    void scheduleResize();
+
+    /**
+     * @brief Set the layout width to the space the widget has
+     */
+    void followWidth();
+
+    /**
+     * @brief Let the layout or sizeHint() set the widget size
+     */
+    void updateSizeConstraint();
+
+    /**
+     * @brief Split the tiles into rows close to the target row height
+     *
+     * Tiles keep their order and their pixmaps
+     */
+    void arrangeRows();
+
+    /**
+     * @brief Rescale the images of a single row
+     *
+     * Tiles show a placeholder until their scaled image arrives
+     * @param row Row to resize
+     */
+    void resizeRow(int row);
+
+    /**
+     * @brief Show the pixmaps of a row, scaling the tiles that need it
+     * @param row Row
+     * @param sizes Size of each tile on the row
+     */
+    void loadRowPixmaps(int row, const QVector<QSize> &sizes);
+
+    /**
+     * @brief Drop the pixmap and decoded images of a tile
+     * @param id Tile id
+     * @param source Image source of the tile
+     */
+    void releaseTile(quint64 id, const QSharedPointer<ImageGridSource> &source);
+
+    /**
+     * @brief Start tracking every tile that has a pixmap as a live tile
+     *
+     * Called when rows become virtual, so tiles scaled before that can
+     * be released by updateLiveRows()
+     */
+    void trackLiveTiles();
+
+    /**
+     * @brief Check if rows away from the visible area go without pixmaps
+     * @return True if virtualized and using PaintedRendering
+     */
+    bool hasVirtualRows() const;
+
+    /**
+     * @brief Queue high quality scaling for every tile showing a preview
+     */
+    void refineTiles();
+
+    /**
+     * @brief Forget the state of a removed tile
+     * @param id Tile id
+     */
+    void forgetTile(quint64 id);
+
+    /**
+     * @brief Show a pixmap for a tile
+     * @param id Tile id
+     * @param pixmap Pixmap to show
+     */
+    void setTilePixmap(quint64 id, const QPixmap &pixmap);
+
+    /**
+     * @brief Create the layout and labels for a row in the model
+     * @param row Row
+     */
+    void insertRowWidgets(int row);
+
+    /**
+     * @brief Delete the layout and labels of a row
+     * @param row Row
+     */
+    void removeRowWidgets(int row);
+
+    /**
+     * @brief Delete the layout of a row and hand over its labels
+     * @param row Row
+     * @param widgets Labels of the row are appended here for the caller to delete
+     */
+    void takeRowWidgets(int row, QList<QWidget *> *widgets);
+
+    /**
+     * @brief Draw the tiles intersecting an area
+     * @param painter Painter to draw with
+     * @param rect Area to draw
+     * @return Number of tiles drawn
+     */
+    int paintTiles(QPainter &painter, const QRect &rect) const;
+
+    /**
+     * @brief Outline the selected tiles intersecting an area
+     * @param painter Painter to draw with
+     * @param rect Area to draw
+     */
+    void paintSelection(QPainter &painter, const QRect &rect) const;
+
     /**
      * @brief Remove icon at row row
      * @param row Row to remove
@@ -167,11 +604,455 @@ public:
      */
     QIcon iconAt(Index index) const;
 
+    /**
+     * @brief Insert an image file as a new row before row
+     *
+     * Only the image header is read here. The image is decoded in the
+     * background at about the size it is shown at, and again at a
+     * larger size only when the tile grows.
+     * @param row Row to insert before, may be equal to getRowCount()
+     * @param path Image file
+     * @return True if the file is a readable image and row is valid
+     */
+    bool insertImage(int row, const QString &path);
+
+    /**
+     * @brief Insert an image read from a device as a new row before row
+     *
+     * The encoded data is read from the device immediately and decoded
+     * like insertImage() does with files
+     * @param row Row to insert before, may be equal to getRowCount()
+     * @param device Device open for reading
+     * @return True if the data is a readable image and row is valid
+     */
+    bool insertImage(int row, QIODevice *device);
+
+    /**
+     * @brief Insert an image file into an existing row before column
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to getColumnCount()
+     * @param path Image file
+     * @return True if the file is a readable image and index is valid
+     */
+    bool insertImage(int row, int column, const QString &path);
+
+    /**
+     * @brief Insert an image read from a device into an existing row before column
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to getColumnCount()
+     * @param device Device open for reading
+     * @return True if the data is a readable image and index is valid
+     */
+    bool insertImage(int row, int column, QIODevice *device);
+
+    /**
+     * @brief Insert icons into an existing row before column
+     *
+     * The grid is laid out once for all of them. Null icons are skipped
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to getColumnCount()
+     * @param icons Icons to add
+     * @return Number of icons inserted
+     */
+    int insertImages(int row, int column, const QList<QIcon> &icons);
+
+    /**
+     * @brief Insert image files into an existing row before column
+     *
+     * The grid is laid out once for all of them. Unreadable files are skipped
+     * @param row Row to insert into
+     * @param column Column to insert before, may be equal to getColumnCount()
+     * @param paths Image files
+     * @return Number of images inserted
+     */
+    int insertImages(int row, int column, const QStringList &paths);
+
+    /**
+     * @brief Add a row of icons after the last row
+     *
+     * The grid is laid out once for all of them. Null icons are skipped
+     * @param icons Icons to add
+     * @return Number of icons added
+     */
+    int appendRow(const QList<QIcon> &icons);
+
+    /**
+     * @brief Add a row of image files after the last row
+     *
+     * The grid is laid out once for all of them. Unreadable files are skipped
+     * @param paths Image files
+     * @return Number of images added
+     */
+    int appendRow(const QStringList &paths);
+
+    /**
+     * @brief Replace the whole grid with rows of icons
+     *
+     * The grid is laid out once for all of them. Null icons are skipped
+     * @param rows Icons of each row
+     * @return Number of icons added
+     */
+    int setGrid(const QList<QList<QIcon>> &rows);
+
+    /**
+     * @brief Replace the whole grid with rows of image files
+     *
+     * The grid is laid out once for all of them. Unreadable files are skipped
+     * @param rows Image files of each row
+     * @return Number of images added
+     */
+    int setGrid(const QList<QStringList> &rows);
+
+    /**
+     * @brief Remove every tile
+     *
+     * Runs in a single pass over the grid and can be undone
+     */
+    void clear();
+
+    /**
+     * @brief Remove whole rows
+     *
+     * Runs in a single pass over the grid and can be undone
+     * @param row First row to remove
+     * @param count Number of rows to remove
+     * @return Number of images removed
+     */
+    int removeRows(int row, int count);
+
+    /**
+     * @brief Remove tiles anywhere in the grid
+     *
+     * Runs in a single pass over the grid and can be undone as one step.
+     * Invalid indexes are skipped
+     * @param tiles Tiles to remove
+     * @return Number of images removed
+     */
+    int removeTiles(const QList<Index> &tiles);
+
+    /**
+     * @brief Check if a tile is selected
+     * @param row Row
+     * @param column Column
+     * @return True if selected
+     */
+    bool isSelected(int row, int column) const;
+
+    /**
+     * @brief Select or deselect a tile
+     *
+     * Ctrl+click toggles the selection of a tile too
+     * @param row Row
+     * @param column Column
+     * @param selected True to select
+     */
+    void setSelected(int row, int column, bool selected);
+
+    /**
+     * @brief Get the selected tiles
+     * @return Indexes in reading order
+     */
+    QList<Index> selectedTiles() const;
+
+    /**
+     * @brief Deselect every tile
+     */
+    void clearSelection();
+
+    /**
+     * @brief Remove the selected tiles
+     *
+     * The Delete key does the same while the widget has focus
+     * @return Number of images removed
+     */
+    int removeSelected();
+
+    /**
+     * @brief Start a batch of changes
+     *
+     * Until the matching endUpdate() inserting and removing tiles only
+     * changes the grid structure. Layout, scaling and painting happen
+     * once when the batch ends. Calls nest
+     */
+    void beginUpdate();
+
+    /**
+     * @brief End a batch of changes started with beginUpdate()
+     *
+     * Lays out, scales and repaints everything the batch changed when
+     * the outermost batch ends
+     */
+    void endUpdate();
+
+    /**
+     * @brief Check if a batch of changes is open
+     * @return True between beginUpdate() and the matching endUpdate()
+     */
+    bool isUpdating() const;
+
+    /**
+     * @brief Get the history of inserted and removed tiles
+     *
+     * Dropping, clicking and the insert, append, setGrid and remove
+     * functions push commands to the stack. Each command only keeps the
+     * position and the shared image source of its tiles, so undoing and
+     * redoing never decode an image again. Use QUndoStack::setUndoLimit() to
+     * bound the history and QUndoStack::createUndoAction() for menus
+     * @return Undo stack owned by the widget
+     */
+    QUndoStack *undoStack() const;
+
+    /**
+     * @brief Get timing stats of the grid
+     *
+     * Recording is off until enabled with ImageGridStats::setEnabled()
+     * or with debug output of the imagegrid.timing logging category
+     * @return Stats
+     */
+    ImageGridStats &stats();
+
+    /**
+     * @brief Get the cache of scaled pixmaps
+     *
+     * Use it to change the byte budget or to read hit and miss counters
+     * @return Pixmap cache
+     */
+    ImageGridPixmapCache &pixmapCache();
+
+    /**
+     * @brief Get how tiles are drawn
+     * @return Render mode
+     */
+    RenderMode renderMode() const;
+
+    /**
+     * @brief Set how tiles are drawn
+     *
+     * PaintedRendering keeps no widgets or layouts per tile and only
+     * draws the tiles that intersect the repainted area.
+     * Defaults to LabelRendering
+     * @param mode Render mode
+     */
+    void setRenderMode(RenderMode mode);
+
+    /**
+     * @brief Check if tiles keep their largest image once mip levels exist
+     * @return True if kept
+     */
+    bool keepOriginals() const;
+
+    /**
+     * @brief Set if tiles keep their largest image once mip levels exist
+     *
+     * Tiles are scaled from a chain of mip levels built the first time
+     * they are shown smaller than half their size. Dropping the largest
+     * image after that saves most of the memory a tile uses. Tiles read
+     * from files or devices decode it again when they need it, tiles
+     * made from icons are shown from their first mip level instead.
+     * Defaults to true
+     * @param keep True to keep them
+     */
+    void setKeepOriginals(bool keep);
+
+    /**
+     * @brief Get the disk cache tiles read from files keep their thumbnails in
+     * @return Cache or null if there is none
+     */
+    QSharedPointer<ImageGridDiskCache> diskCache() const;
+
+    /**
+     * @brief Set the disk cache tiles read from files keep their thumbnails in
+     *
+     * Tiles then read their scaled images back from the cache instead of
+     * decoding the file again, also on later runs. The cache can be
+     * shared with other widgets. Defaults to null
+     * @param cache Cache, null to always decode
+     */
+    void setDiskCache(const QSharedPointer<ImageGridDiskCache> &cache);
+
+    /**
+     * @brief Get how tile sizes on a row are calculated
+     * @return Layout mode
+     */
+    ImageGridLayout::Mode layoutMode() const;
+
+    /**
+     * @brief Set how tile sizes on a row are calculated
+     *
+     * JustifiedRows keeps the aspect ratio of every image instead of
+     * sizing all of them like the first one. Defaults to UniformRows
+     * @param mode Layout mode
+     */
+    void setLayoutMode(ImageGridLayout::Mode mode);
+
+    /**
+     * @brief Get the row height tiles are arranged around
+     * @return Height in pixels, 0 if rows are kept as dropped
+     */
+    int targetRowHeight() const;
+
+    /**
+     * @brief Arrange tiles into rows automatically
+     *
+     * Tiles keep their order but are split into new rows whose heights
+     * are as close to height as possible. Rows are split again after
+     * every insert, removal or move and whenever width, spacing or
+     * layout mode change, so only the order of the tiles is kept and
+     * whole rows can't be dragged. Best used with JustifiedRows.
+     * A value of zero keeps the rows as dropped
+     * @param height Target row height in pixels
+     */
+    void setTargetRowHeight(int height);
+
+    /**
+     * @brief Render the grid to an image file at any width
+     *
+     * The grid is laid out again at the requested width, with spacing
+     * scaled by the same factor, and rendered from the source images
+     * in bands of as many rows as the compositor has threads
+     * (QThread::idealThreadCount()). Each band is written to the file
+     * before the next one is rendered, so memory use is bounded by one
+     * band: the thread count times the tallest rows.
+     *
+     * Supported formats are PPM and BMP, chosen by file suffix.
+     * A transparent background color is written as white.
+     * @param path File to write
+     * @param width Width of the image in pixels
+     * @return True on success
+     */
+    bool exportTo(const QString &path, int width);
+
+    /**
+     * @brief Save the grid and its settings to a project file
+     *
+     * Every tile is saved with a thumbnail at the size it is shown at,
+     * taken from its pixmap when it has been scaled already. Images
+     * read from files are saved as paths, everything else is embedded
+     * @param path Project file
+     * @return True on success
+     */
+    bool saveProject(const QString &path);
+
+    /**
+     * @brief Replace the grid with a project saved by saveProject()
+     *
+     * Tiles are shown from the thumbnails in the project, which are
+     * memory-mapped rather than read. Images are read from their files
+     * only when a tile is shown larger than its thumbnail. Clears the
+     * undo stack
+     * @param path Project file
+     * @return True on success
+     */
+    bool loadProject(const QString &path);
+
+    QSize sizeHint() const override;
+
+    QSize minimumSizeHint() const override;
+
+    /**
+     * @brief Check if tiles are rendered progressively
+     * @return True if progressive
+     */
+    bool isProgressive() const;
+
+    /**
+     * @brief Set if tiles are rendered progressively
+     *
+     * A resized tile immediately shows its old pixmap scaled with
+     * Qt::FastTransformation, or the image its source already holds,
+     * instead of a placeholder. Once the layout has not changed for
+     * refineDelay() the previews are replaced by images from the
+     * scaler, which drops jobs a newer layout has made stale.
+     * Tiles with nothing to preview are scaled right away.
+     * Defaults to false
+     * @param progressive True to render progressively
+     */
+    void setProgressive(bool progressive);
+
+    /**
+     * @brief Get how long the layout must be unchanged before previews are refined
+     * @return Delay in milliseconds
+     */
+    int refineDelay() const;
+
+    /**
+     * @brief Set how long the layout must be unchanged before previews are refined
+     *
+     * Defaults to 250 milliseconds
+     * @param msec Delay in milliseconds
+     */
+    void setRefineDelay(int msec);
+
+    /**
+     * @brief Check if the layout width follows the widget width
+     * @return True if following
+     */
+    bool followsWidth() const;
+
+    /**
+     * @brief Set if the layout width follows the widget width
+     *
+     * The grid is laid out again as the widget is resized, at most once
+     * per frame, and setWidth() has no lasting effect. Put the widget in
+     * a resizable QScrollArea to fill its viewport. Defaults to false
+     * @param follow True to follow
+     */
+    void setFollowsWidth(bool follow);
+
+    /**
+     * @brief Check if only rows near the visible area have pixmaps
+     * @return True if virtualized
+     */
+    bool isVirtualized() const;
+
+    /**
+     * @brief Set if only rows near the visible area have pixmaps
+     *
+     * Row sizes still come from the model for the whole grid, so the
+     * widget keeps its full height in a QScrollArea. Pixmaps are made for
+     * the rows in and around the visible area, a page ahead in the scroll
+     * direction, and rows more than two pages away drop their pixmaps and
+     * decoded images again, which keeps memory use flat however large
+     * the grid is. Only has an effect with PaintedRendering.
+     * Defaults to false
+     * @param virtualized True to virtualize
+     */
+    void setVirtualized(bool virtualized);
+
 signals:
+    /**
+     * @brief Emitted when tiles are selected or deselected
+     */
+    void selectionChanged();
+
+private slots:
+    /**
+     * @brief Show a scaled image if it's still wanted
+     * @param id Tile id
+     * @param image Scaled image
+     */
+    void onTileScaled(quint64 id, const QImage &image);
+
+    /**
+     * @brief Show an error placeholder for a tile that couldn't be scaled
+     *
+     * The tile isn't scaled again until its size changes
+     * @param id Tile id
+     * @param size Size the tile was queued with
+     */
+    void onTileFailed(quint64 id, const QSize &size);
+
+    /**
+     * @brief Make pixmaps for rows near the visible area and drop the rest
+     */
+    void updateLiveRows();
 
 public slots:
     /**
      * @brief Set space between images in pixels
+     *
+     * The grid is laid out again on the next event loop turn, once for
+     * every property changed until then
      * @param spacing Space between images
      */
     void setSpacing(int spacing);
@@ -179,7 +1060,8 @@ public slots:
     /**
      * @brief Set layout width
      *
-     * A value of zero will use image width as width
+     * A value of zero will use image width as width.
+     * The grid is laid out again on the next event loop turn
      * @param width Width in pixels
      */
     void setWidth(int width);
@@ -197,6 +1079,10 @@ public slots:
     void setBackgroundColor(const QColor &color);
 
 protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+    void showEvent(QShowEvent *event) override;
+
     void dragEnterEvent(QDragEnterEvent *event) override;
 
     void dragLeaveEvent(QDragLeaveEvent *event) override;
@@ -205,8 +1091,14 @@ protected:
 
     void dropEvent(QDropEvent *event) override;
 
+    void keyPressEvent(QKeyEvent *event) override;
+
     void mousePressEvent(QMouseEvent *event) override;
 
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
     void paintEvent(QPaintEvent *event) override;
 };
 